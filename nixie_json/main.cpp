@@ -1,6 +1,13 @@
 #include "nixie_encoding/json.hpp"
 #include "iostream"
 
+//structs are bound once at global scope so heaps can read and write them.
+struct example_item {
+	std::string name;
+	int count;
+};
+NIXIE_JSON_BINDING(example_item, NIXIE_JSON_FIELD(example_item, name), NIXIE_JSON_FIELD(example_item, count))
+
 int main(int argc, const char* argv[]) {
 	//the json heap manages all memory internally. just don't try to access json_nodes created from other json_heaps.
 	nix::json_heap json;
@@ -70,6 +77,185 @@ int main(int argc, const char* argv[]) {
 		}
 	}
 
+	//paths are compiled once and can then select nodes from any heap.
+	printf("\n[json paths]\n");
+	nix::json_path path;
+	path.compile("$.player.items[1:3]");
+	nix::json_node selected[8];
+	uint32_t selected_count = path.select(copy, root, selected, 8);
+	for (uint32_t i = 0; i < selected_count; ++i)
+		printf("selected item = %s\n", copy.to_string(selected[i], "not a string"));
+	path.compile("/player/name");
+	printf("selected name = %s\n", copy.to_string(path.select(copy, root), "missing"));
+
+	//heaps with chunked storage never move nodes or strings once they are made, so strings remain valid while the heap grows.
+	printf("\n[chunked storage]\n");
+	nix::json_heap chunked(nix::json_storage_chunked);
+	nix::json_node list = chunked.new_array();
+	nix::json_string first = chunked.to_string(chunked.new_string(list, "first"));
+	for (int i = 0; i < 10000; ++i)
+		chunked.new_number(list, i);
+	printf("first = %s\n", first);
+
+	//lazy loading only decodes the values you access. the source text must outlive the lazy nodes.
+	printf("\n[lazy loading]\n");
+	nix::json_heap lazy;
+	nix::json_node lazy_root = lazy.load_lazy("{\"skipped\": [1, 2, 3], \"wanted\": {\"name\": \"steve\"}}");
+	printf("wanted name = %s\n", lazy.to_string(lazy.get_child(lazy.get_child(lazy_root, "wanted"), "name"), "missing"));
+	//strings read earlier stay valid while later reads resolve more nodes.
+	nix::json_node pair = lazy.load_lazy("{\"a\": \"hello\", \"b\": \"world\"}");
+	nix::json_string hello = lazy.to_string(lazy.get_child(pair, "a"));
+	nix::json_string world = lazy.to_string(lazy.get_child(pair, "b"));
+	printf("a = %s, b = %s\n", hello, world);
+
+	//nodes can be edited in place. removed nodes are reused and compact reclaims their strings.
+	printf("\n[editing]\n");
+	nix::json_node wanted = lazy.get_child(lazy_root, "wanted");
+	lazy.remove(lazy.get_child(lazy_root, "skipped"));
+	lazy.set_string(lazy.get_child(wanted, "name"), "alex");
+	lazy.set_name(wanted, "found");
+	lazy.compact();
+	printf("edited = %s\n", lazy.save_string(lazy_root, nix::json_format_dense));
+
+	//writers append to an open object or array without checking the parent on every call.
+	printf("\n[writing]\n");
+	nix::json_heap written;
+	nix::json_writer writer(written);
+	writer.reserve(8, 64);
+	nix::json_node written_root = writer.begin_object();
+	writer.write_string("name", "steve");
+	writer.begin_array("scores");
+	for (int i = 0; i < 3; ++i)
+		writer.write_number(i * 10);
+	writer.end();
+	writer.end();
+	printf("written = %s\n", written.save_string(written_root, nix::json_format_dense));
+
+	//patches edit a document in place instead of rebuilding it.
+	printf("\n[patching]\n");
+	nix::json_heap operations;
+	nix::json_node operations_root = operations.load_string("[{\"op\": \"replace\", \"path\": \"/name\", \"value\": \"alex\"}, {\"op\": \"add\", \"path\": \"/scores/0\", \"value\": 5}]");
+	written.apply_patch(written_root, operations, operations_root);
+	printf("patched = %s\n", written.save_string(written_root, nix::json_format_dense));
+
+	//diffs make the patch that turns one document into another.
+	printf("\n[diffing]\n");
+	nix::json_heap before;
+	nix::json_node before_root = before.load_string("{\"name\": \"steve\", \"scores\": [0, 10, 20]}");
+	nix::json_heap changes;
+	nix::json_node changes_root = changes.diff(before, before_root, written, written_root);
+	printf("changes = %s\n", changes.save_string(changes_root, nix::json_format_dense));
+
+	//hashes and equality ignore member order. the hash cache skips subtrees that did not change since the last call.
+	printf("\n[hashing]\n");
+	written.set_hash_cache(true);
+	nix::json_node reordered_root = before.load_string("{\"scores\": [5, 0, 10, 20], \"name\": \"alex\"}");
+	printf("equal = %d, same hash = %d\n", nix::json_heap::equal(written, written_root, before, reordered_root), written.hash(written_root) == before.hash(reordered_root));
+
+	//bound structs are read in one pass over an object's members.
+	printf("\n[binding]\n");
+	nix::json_heap bound;
+	example_item item = {};
+	bound.read(bound.load_string("{\"name\": \"arrow\", \"count\": 64}"), item);
+	item.count /= 2;
+	printf("item = %s\n", bound.save_string(bound.write(item), nix::json_format_dense));
+
+	//bound structs can also be parsed straight from text without making any nodes. unknown members are skipped.
+	printf("\n[parsing]\n");
+	std::vector<example_item> items;
+	nix::json_parser parser("[{\"name\": \"bow\", \"count\": 1}, {\"name\": \"arrow\", \"count\": 64, \"unused\": [1, 2]}]");
+	if (parser.parse(items))
+		printf("items = %zu, last = %s x%d\n", items.size(), items.back().name.c_str(), items.back().count);
+
+	//newline delimited json is read one record per line. malformed records are skipped without leaving nodes behind.
+	printf("\n[lines]\n");
+	nix::json_heap lines;
+	nix::json_line_reader reader("{\"id\": 1}\r\n{\"id\": }\n\n[true, null]\n");
+	nix::json_node records[8];
+	uint32_t record_count = reader.next(lines, records, 8);
+	printf("records = %u, lines = %llu\n%s", record_count, (unsigned long long)reader.get_line(), lines.save_lines(records, record_count));
+
+	//pretty json can be laid out with a style. measure returns the exact length so the output is allocated once.
+	printf("\n[styling]\n");
+	nix::json_style style;
+	style.indent = 4;
+	style.array_width = 40;
+	nix::json_node styled = lines.load_string("{\"name\": \"grid\", \"cells\": [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18]}");
+	lines.reserve_output(lines.measure(styled, style));
+	printf("%s\n", lines.save_string(styled, style));
+
+	//loading can describe where and why malformed json was rejected.
+	printf("\n[errors]\n");
+	nix::json_error error;
+	if (!lines.load_string("{\n  \"cells\": [1, 2,, 3]\n}", nix::json_format_pretty, error))
+		printf("code = %d at %llu:%llu (%s)\n", error.code, (unsigned long long)error.line, (unsigned long long)error.column, error.path.c_str());
+	//validate makes no nodes and rejects the same strings the loaders do, like unpaired surrogates.
+	const char* unpaired = "[\"\\ud800\", \"\\udc00x\"]";
+	printf("validate paired = %d, unpaired = %d\n", nix::json_heap::validate("\"\\ud83d\\ude00\"", 14), nix::json_heap::validate(unpaired, strlen(unpaired)));
+
+	//children and members can be used in range based for loops; descendants walks a whole subtree.
+	printf("\n[iterating]\n");
+	for (const nix::json_child& member : lines.members(styled))
+		printf("%s ", member.name);
+	uint32_t descendant_count = 0;
+	for (nix::json_node descendant : lines.descendants(styled))
+		descendant_count += descendant != 0;
+	printf("\ndescendants = %u\n", descendant_count);
+
+	//whole heaps and subtrees can be scanned by several threads at once.
+	printf("\n[scanning]\n");
+	nix::json_number_stats stats = lines.get_number_stats(styled);
+	uint64_t strings = lines.reduce(nix::json_type_string, uint64_t(0), [](nix::json_node) { return uint64_t(1); }, [](uint64_t a, uint64_t b) { return a + b; });
+	printf("numbers = %llu, sum = %g, max = %g, strings = %llu\n", (unsigned long long)stats.count, stats.sum, stats.max, (unsigned long long)strings);
+
+	//arrays of objects can be copied into one typed column per member.
+	printf("\n[columns]\n");
+	std::vector<nix::json_column> columns;
+	nix::json_node table = lines.load_string("[{\"ts\": 1, \"tag\": \"a\"}, {\"ts\": 2}, {\"tag\": \"c\", \"ts\": 3}]");
+	uint32_t rows = lines.extract_columns(table, { "ts", "tag" }, columns);
+	for (uint32_t row = 0; row < rows; ++row)
+		printf("%g %.*s\n", columns[0].numbers[row], int(columns[1].offsets[row + 1] - columns[1].offsets[row]), columns[1].chars.data() + columns[1].offsets[row]);
+
+	//failed loads leave nothing behind. other changes can be made speculatively and rolled back to a mark.
+	printf("\n[rollback]\n");
+	nix::json_mark mark = lines.mark();
+	lines.new_number(lines.get_child(styled, "cells"), 19);
+	lines.new_string(styled, "draft", "discarded");
+	lines.rollback(mark);
+	printf("%s\n", lines.save_string(styled, nix::json_format_dense));
+	//lazy nodes are resolved when a heap is marked, so values read while the mark is open survive the rollback.
+	nix::json_node lazy_draft = lazy.load_lazy("{\"a\": [1, 2, 3], \"b\": 2}");
+	nix::json_mark lazy_mark = lazy.mark();
+	lazy.get_child(lazy_draft, "a");
+	lazy.rollback(lazy_mark);
+	printf("%s\n", lazy.save_string(lazy_draft, nix::json_format_dense));
+
+	//objects loaded with the same names in the same order share a shape, so their names are stored once and their members are found by index.
+	printf("\n[shapes]\n");
+	nix::json_node points = lines.load_string("[{\"x\": 1, \"y\": 2}, {\"x\": 3, \"y\": 4}, {\"y\": 5, \"x\": 6}]");
+	for (nix::json_node point = lines.get_first(points); point; point = lines.get_next(point))
+		printf("shape = %u, y = %g\n", lines.get_shape(point), lines.to_number(lines.get_child(point, "y"), 0.0));
+
+	//files can be written and read on a background thread, so disk access overlaps with saving and parsing.
+	printf("\n[files]\n");
+	nix::json_file_writer file_writer;
+	std::future<bool> saved = file_writer.write("points.json", lines, points, nix::json_format_dense);
+	file_writer.write("styled.json", lines, styled, nix::json_format_dense);
+	printf("saved = %d, flushed = %d\n", saved.get(), file_writer.flush());
+	nix::json_string paths[] = { "points.json", "missing.json", "styled.json" };
+	nix::json_file_reader file_reader(paths, 3);
+	while (!file_reader.is_end()) {
+		nix::json_node file = file_reader.next(lines, nix::json_format_dense, error);
+		printf("%s: %s\n", file_reader.get_path(), file ? lines.save_string(file, nix::json_format_dense) : "could not be loaded");
+	}
+	remove("points.json");
+	remove("styled.json");
+
+	//gzip files are recognized when loading and can be written when json.cpp is compiled with NIXIE_JSON_ZLIB.
+	if (lines.save_file(points, "points.json.gz", nix::json_format_dense, nix::json_compression_gzip)) {
+		printf("gzip = %s\n", lines.save_string(lines.load_file("points.json.gz"), nix::json_format_dense));
+		remove("points.json.gz");
+	}
 
 	return 0;
 }
@@ -2,7 +2,55 @@
 #include "json.hpp"
 #include "sstream"
 #include "fstream"
+#include "algorithm"
+#include "new"
+#include "thread"
+#include "mutex"
+#include "condition_variable"
+#include "deque"
+#ifdef NIXIE_JSON_ZLIB
+#include "zlib.h"
+#endif
+#ifdef _MSC_VER
+#include "intrin.h"
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NIXIE_JSON_SSE2
+#include "emmintrin.h"
+#endif
 
+struct nix::json_heap::json_shapes {
+	//a name shared by every member loaded with it. the prefix is the quoted name and colon, made once a shape uses the name.
+	struct name {
+		json_node id;
+		json_node prefix;
+		uint32_t hash;
+		uint32_t length;
+		uint32_t prefix_length;
+	};
+	//a sequence of names, found in the keys.
+	struct shape {
+		uint64_t hash;
+		uint32_t keys;
+		uint32_t count;
+	};
+	//the id of a name and its index in names.
+	struct key {
+		json_node id;
+		uint32_t name;
+	};
+	//the slots are open addressed tables of indices plus one. names are in the order their chars were made.
+	std::vector<name> names;
+	std::vector<uint32_t> name_slots;
+	std::vector<shape> shapes;
+	std::vector<key> keys;
+	std::vector<uint32_t> shape_slots;
+	//the highest id of any name or prefix.
+	json_node last = 0;
+	//the shape of the object closed last at each depth, which the next object there is expected to have.
+	static constexpr uint32_t depth = 32u;
+	uint16_t recent[depth] = {};
+};
 struct nix::json_heap::json_utils {
 	static constexpr char escapes[256] = {
 		0,0,0,0,0,0,0,0,'b','t','n',0,'f','r',0,0,
@@ -41,71 +89,690 @@ struct nix::json_heap::json_utils {
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 	};
 
+	static constexpr uint8_t chunk_nodes_shift = 12u;
+	static constexpr uint8_t chunk_chars_shift = 16u;
+	static constexpr uint8_t contiguous_shift = 32u;
+
+	inline static constexpr uint32_t chunk_mask(uint8_t shift) noexcept {
+		return uint32_t((uint64_t(1) << shift) - 1u);
+	}
+	inline static json_value& value(const json_heap& h, json_node node) noexcept {
+		return h.m_values[uint64_t(node) >> h.m_values_shift].data[node & chunk_mask(h.m_values_shift)];
+	}
+	inline static json_char* chars(const json_heap& h, json_node id) noexcept {
+		return h.m_chars[uint64_t(id) >> h.m_chars_shift].data + (id & chunk_mask(h.m_chars_shift));
+	}
+
+	inline static uint32_t table_capacity(uint32_t chunks) noexcept {
+		//chunk tables grow in powers of two so appending chunks is amortized.
+		uint32_t capacity = chunks ? 1u : 0u;
+		while (capacity < chunks) capacity += capacity;
+		return capacity;
+	}
+	template<typename T>
+	inline static bool grow_contiguous(json_chunk<T>*& table, uint32_t& chunks, uint32_t& capacity, uint32_t used, uint32_t ncapacity) noexcept {
+		if (!chunks) {
+			table = (json_chunk<T>*)malloc(sizeof(json_chunk<T>));
+			if (!table)
+				return false;
+			table[0] = { 0, true };
+			chunks = 1;
+		}
+		T* data = (T*)malloc(size_t(ncapacity) * sizeof(T));
+		if (!data)
+			return false;
+		if (used)
+			memcpy(data, table[0].data, size_t(used) * sizeof(T));
+		free(table[0].data);
+		table[0].data = data;
+		capacity = ncapacity;
+		return true;
+	}
+	template<typename T>
+	inline static bool grow_chunked(json_chunk<T>*& table, uint32_t& chunks, uint32_t& capacity, uint8_t shift, uint64_t ncapacity) noexcept {
+		uint64_t nchunksl = (ncapacity + chunk_mask(shift)) >> shift;
+		if (nchunksl <= chunks)
+			return true;
+		if (nchunksl > (std::numeric_limits<uint32_t>::max() >> 1))
+			return false;
+		uint32_t nchunks = uint32_t(nchunksl);
+		uint32_t tcapacity = table_capacity(nchunks);
+		if (tcapacity != table_capacity(chunks)) {
+			json_chunk<T>* ntable = (json_chunk<T>*)malloc(tcapacity * sizeof(json_chunk<T>));
+			if (!ntable)
+				return false;
+			if (chunks)
+				memcpy(ntable, table, chunks * sizeof(json_chunk<T>));
+			free(table);
+			table = ntable;
+		}
+		//new chunks are carved from one block so that they form a contiguous run. only the first chunk owns the block.
+		T* data = (T*)malloc((size_t(nchunks - chunks) << shift) * sizeof(T));
+		if (!data)
+			return false;
+		for (uint32_t i = chunks; i < nchunks; ++i)
+			table[i] = { data + (size_t(i - chunks) << shift), i == chunks };
+		chunks = nchunks;
+		capacity = uint32_t(std::min<uint64_t>(uint64_t(nchunks) << shift, std::numeric_limits<uint32_t>::max()));
+		return true;
+	}
+	template<typename T>
+	inline static bool is_run(const json_chunk<T>* table, uint32_t chunks, uint32_t first, uint32_t count) noexcept {
+		if (uint64_t(first) + count > chunks)
+			return false;
+		for (uint32_t i = first + 1; i < first + count; ++i)
+			if (table[i].owner)
+				return false;
+		return true;
+	}
+	template<typename T>
+	inline static void copy_chunks(json_chunk<T>* dst, const json_chunk<T>* src, uint64_t count, uint8_t shift) noexcept {
+		uint64_t size = uint64_t(1) << shift;
+		for (uint32_t i = 0; (uint64_t(i) << shift) < count; ++i)
+			memcpy(dst[i].data, src[i].data, size_t(std::min(size, count - (uint64_t(i) << shift))) * sizeof(T));
+	}
+	template<typename T>
+	inline static void free_chunks(json_chunk<T>*& table, uint32_t& chunks, uint32_t& capacity) noexcept {
+		for (uint32_t i = 0; i < chunks; ++i)
+			if (table[i].owner)
+				free(table[i].data);
+		free(table);
+		table = 0;
+		chunks = 0;
+		capacity = 0;
+	}
+
+	template<typename T>
+	inline static void shrink_contiguous(json_chunk<T>*& table, uint32_t& chunks, uint32_t& capacity, uint32_t used) noexcept {
+		if (!used) {
+			free_chunks(table, chunks, capacity);
+			return;
+		}
+		if (used >= capacity)
+			return;
+		T* data = (T*)malloc(size_t(used) * sizeof(T));
+		if (!data)
+			return;
+		memcpy(data, table[0].data, size_t(used) * sizeof(T));
+		free(table[0].data);
+		table[0].data = data;
+		capacity = used;
+	}
+	template<typename T>
+	inline static void shrink_chunked(json_chunk<T>*& table, uint32_t& chunks, uint32_t& capacity, uint8_t shift, uint32_t used) noexcept {
+		//only whole blocks can be released, so trailing blocks are released while none of their chunks are used.
+		uint32_t nchunks = chunks;
+		uint32_t uchunks = uint32_t((uint64_t(used) + chunk_mask(shift)) >> shift);
+		while (nchunks > uchunks) {
+			uint32_t owner = nchunks - 1;
+			while (!table[owner].owner) --owner;
+			if (owner < uchunks)
+				break;
+			free(table[owner].data);
+			nchunks = owner;
+		}
+		if (!nchunks) {
+			free(table);
+			table = 0;
+			chunks = 0;
+			capacity = 0;
+			return;
+		}
+		if (table_capacity(nchunks) != table_capacity(chunks)) {
+			json_chunk<T>* ntable = (json_chunk<T>*)malloc(table_capacity(nchunks) * sizeof(json_chunk<T>));
+			//keep the larger table if something went wrong; it still fits fewer chunks.
+			if (ntable) {
+				memcpy(ntable, table, nchunks * sizeof(json_chunk<T>));
+				free(table);
+				table = ntable;
+			}
+		}
+		chunks = nchunks;
+		capacity = uint32_t(std::min<uint64_t>(uint64_t(chunks) << shift, std::numeric_limits<uint32_t>::max()));
+	}
+
+	inline static void set_storage(json_heap& h, json_storage storage) noexcept {
+		h.m_storage = storage;
+		h.m_values_shift = storage == json_storage_chunked ? chunk_nodes_shift : contiguous_shift;
+		h.m_chars_shift = storage == json_storage_chunked ? chunk_chars_shift : contiguous_shift;
+	}
+	inline static void release(json_heap& h) noexcept {
+		free_chunks(h.m_values, h.m_values_chunks, h.m_values_capacity);
+		free_chunks(h.m_chars, h.m_chars_chunks, h.m_chars_capacity);
+		free_hashes(h);
+		delete h.m_shapes;
+		h.m_shapes = 0;
+		h.m_values_count = 0;
+		h.m_chars_count = 0;
+		h.m_free = 0;
+		h.m_marks = 0;
+		h.m_lazy_chars = 0;
+	}
+	inline static bool copy(json_heap& h, const json_heap& source) noexcept {
+		//ids must stay the same so chunks are copied in place. reserving the whole pool at once keeps runs contiguous.
+		if (!h.reserve_chars(source.m_chars_count + source.m_lazy_chars))
+			return false;
+		if (!h.reserve_nodes(source.m_values_count))
+			return false;
+		copy_chunks(h.m_chars, source.m_chars, source.m_chars_count, h.m_chars_shift);
+		copy_chunks(h.m_values, source.m_values, source.m_values_count ? source.m_values_count + 1u : 0u, h.m_values_shift);
+		h.m_chars_count = source.m_chars_count;
+		h.m_values_count = source.m_values_count;
+		h.m_free = source.m_free;
+		h.m_marks = source.m_marks;
+		h.m_strict = source.m_strict;
+		h.m_lazy_chars = source.m_lazy_chars;
+		h.m_hashing = source.m_hashing;
+		clear_hashes(h);
+		if (!copy_shapes(h, source))
+			return false;
+		dump_clear(h);
+		if (!dump_grow(h, source.m_dump_count))
+			return false;
+		if (source.m_dump_count)
+			memcpy(h.m_dump, source.m_dump, source.m_dump_count * sizeof(json_char));
+		h.m_dump_count = source.m_dump_count;
+		return true;
+	}
+	inline static bool can_copy_in_place(const json_heap& h, const json_heap& source) noexcept {
+		//reused memory must be one run per pool, otherwise strings that span chunks would be split.
+		return h.m_storage == source.m_storage
+			&& h.m_values_capacity > source.m_values_count && is_run(h.m_values, h.m_values_chunks, 0, h.m_values_chunks)
+			&& h.m_chars_capacity >= source.m_chars_count && is_run(h.m_chars, h.m_chars_chunks, 0, h.m_chars_chunks);
+	}
+	inline static bool copy_subtree_size(const json_heap& source, json_node node, json_node end, uint32_t& nodes, uint64_t& strings) noexcept {
+		//walks the subtree in preorder using the sibling and parent links.
+		json_node curr = node;
+		while (true) {
+			const json_value& v = value(source, curr);
+			++nodes;
+			if (v.name)
+				strings += strlen(chars(source, v.name)) + 1;
+			if (v.type == json_type_string)
+				strings += strlen(chars(source, v.string.value)) + 1;
+			json_node next = (v.type == json_type_object || v.type == json_type_array) ? v.object_or_array.first : 0;
+			while (!next || next > end) {
+				if (curr == node)
+					return nodes < std::numeric_limits<uint32_t>::max() && strings < std::numeric_limits<uint32_t>::max();
+				next = value(source, curr).next;
+				if (next && next <= end)
+					break;
+				curr = value(source, curr).parent;
+				next = 0;
+			}
+			curr = next;
+		}
+	}
+	inline static json_node copy_value(json_heap& h, const json_heap& source, json_node node, json_node parent, json_node name) noexcept {
+		//space was reserved up front, so this never moves the source when copying within one heap.
+		json_node copy = parent ? alloc_node(h, parent, name) : alloc_node(h);
+		if (!copy)
+			return 0;
+		const json_value& v = value(source, node);
+		json_value& c = value(h, copy);
+		c.type = v.type;
+		if (v.type == json_type_boolean)
+			c.boolean.value = v.boolean.value;
+		else if (v.type == json_type_number)
+			c.number.value = v.number.value;
+		else if (v.type == json_type_string)
+			c.string.value = alloc_string(h, chars(source, v.string.value));
+		else if (v.type == json_type_object || v.type == json_type_array)
+			c.object_or_array = {};
+		return copy;
+	}
+	inline static json_node copy_tree(json_heap& h, const json_heap& source, json_node node, json_node parent, json_string name) noexcept {
+		if (source.is_invalid(node))
+			return 0;
+		if (parent && ((!h.is_object(parent) && !h.is_array(parent)) || !resolve(h, parent)))
+			return 0;
+		resolve_subtree(source, node);
+		//nodes made by the copy are never visited when a heap copies into itself.
+		json_node end = source.m_values_count;
+		uint32_t nodes = 0;
+		uint64_t strings = name ? strlen(name) + 1 : 0;
+		if (!copy_subtree_size(source, node, end, nodes, strings))
+			return 0;
+		if (!h.reserve_nodes(nodes) || !h.reserve_chars(uint32_t(strings) + 1u))
+			return 0;
+		json_node root = copy_value(h, source, node, parent, name ? alloc_string(h, name) : 0);
+		if (!root)
+			return 0;
+		json_node curr = node;
+		json_node copy = root;
+		while (true) {
+			const json_value& v = value(source, curr);
+			json_node next = (v.type == json_type_object || v.type == json_type_array) ? v.object_or_array.first : 0;
+			if (next && next <= end) {
+				//descend into the first child.
+				json_node child = next;
+				copy = copy_value(h, source, child, copy, value(source, child).name ? alloc_string(h, chars(source, value(source, child).name)) : 0);
+				curr = child;
+				continue;
+			}
+			//climb until a node has a next sibling.
+			while (true) {
+				if (curr == node)
+					return root;
+				next = value(source, curr).next;
+				copy = value(h, copy).parent;
+				if (next && next <= end)
+					break;
+				curr = value(source, curr).parent;
+			}
+			copy = copy_value(h, source, next, copy, value(source, next).name ? alloc_string(h, chars(source, value(source, next).name)) : 0);
+			curr = next;
+		}
+	}
+	inline static json_node copy_subtree(json_heap& h, const json_heap& source, json_node node, json_node parent, json_string name) noexcept {
+		if (&h != &source)
+			return copy_tree(h, source, node, parent, name);
+		//reused ids could fall inside the subtree being copied, so a heap copying into itself only appends.
+		json_node free = h.m_free;
+		h.m_free = 0;
+		json_node copy = copy_tree(h, source, node, parent, name);
+		h.m_free = free;
+		return copy;
+	}
+	inline static void steal(json_heap& h, json_heap& source) noexcept {
+		set_storage(h, source.m_storage);
+		h.m_strict = source.m_strict;
+		h.m_lazy_chars = source.m_lazy_chars;
+		h.m_values_capacity = source.m_values_capacity;
+		h.m_values_count = source.m_values_count;
+		h.m_values_chunks = source.m_values_chunks;
+		h.m_values = source.m_values;
+		h.m_free = source.m_free;
+		h.m_marks = source.m_marks;
+		h.m_hashing = source.m_hashing;
+		h.m_hashes_capacity = source.m_hashes_capacity;
+		h.m_hashes = source.m_hashes;
+		h.m_shapes = source.m_shapes;
+		h.m_chars_capacity = source.m_chars_capacity;
+		h.m_chars_count = source.m_chars_count;
+		h.m_chars_chunks = source.m_chars_chunks;
+		h.m_chars = source.m_chars;
+		h.m_dump_capacity = source.m_dump_capacity;
+		h.m_dump_count = source.m_dump_count;
+		h.m_dump = source.m_dump;
+		source.m_values_capacity = 0;
+		source.m_values_count = 0;
+		source.m_values_chunks = 0;
+		source.m_values = 0;
+		source.m_free = 0;
+		source.m_marks = 0;
+		source.m_lazy_chars = 0;
+		source.m_hashes_capacity = 0;
+		source.m_hashes = 0;
+		source.m_shapes = 0;
+		source.m_chars_capacity = 0;
+		source.m_chars_count = 0;
+		source.m_chars_chunks = 0;
+		source.m_chars = 0;
+		source.m_dump_capacity = 0;
+		source.m_dump_count = 0;
+		source.m_dump = 0;
+	}
+
+	inline static json_node alloc_chars(json_heap& h, uint32_t length, bool lazy = false) noexcept {
+		if (h.m_storage != json_storage_chunked) {
+			//room for resolving lazy nodes is kept free, so const reads never move the pool. resolving takes from that room.
+			uint64_t keep = lazy ? 0u : h.m_lazy_chars;
+			if (h.m_chars_count + length + keep + 1u > h.m_chars_capacity && keep + length + 1u > std::numeric_limits<uint32_t>::max())
+				return 0;
+			uint32_t needed = uint32_t(keep + length + 1u);
+			if (h.m_chars_count + uint64_t(needed) > h.m_chars_capacity && !h.reserve_chars(std::max(needed, h.m_chars_count)) && !h.reserve_chars(needed))
+				return 0;
+			if (!h.m_chars_count)
+				h.m_chars_count = 1;
+			json_node start = h.m_chars_count;
+			h.m_chars_count += length;
+			if (lazy)
+				h.m_lazy_chars -= std::min(h.m_lazy_chars, length);
+			return start;
+		}
+		//chunked strings never straddle chunks unless they fit in a contiguous run of chunks.
+		uint64_t size = uint64_t(1) << h.m_chars_shift;
+		uint64_t start = h.m_chars_count ? h.m_chars_count : 1;
+		if ((start & chunk_mask(h.m_chars_shift)) + length > size) {
+			start = (start + size - 1) & ~(size - 1);
+			uint32_t count = uint32_t((length + size - 1) >> h.m_chars_shift);
+			if (count > 1 && !is_run(h.m_chars, h.m_chars_chunks, uint32_t(start >> h.m_chars_shift), count))
+				start = uint64_t(h.m_chars_chunks) << h.m_chars_shift;
+		}
+		if (start + length > std::numeric_limits<uint32_t>::max())
+			return 0;
+		if (!grow_chunked(h.m_chars, h.m_chars_chunks, h.m_chars_capacity, h.m_chars_shift, start + length))
+			return 0;
+		h.m_chars_count = uint32_t(start + length);
+		return json_node(start);
+	}
 	inline static json_node alloc_string(json_heap& h, json_string string) noexcept {
 		size_t lengthl = strlen(string) + 1;
-		if (lengthl > std::numeric_limits<uint32_t>::max())
+		if (lengthl >= std::numeric_limits<uint32_t>::max())
 			return 0;
 		uint32_t length = uint32_t(lengthl);
-		if (!h.reserve_chars(length + 1))
+		//a string from this heap's own contiguous pool is found again by id in case the pool moves.
+		json_node id = 0;
+		if (h.m_storage != json_storage_chunked && h.m_chars_chunks && string > h.m_chars[0].data && string < h.m_chars[0].data + h.m_chars_count)
+			id = json_node(string - h.m_chars[0].data);
+		json_node start = alloc_chars(h, length);
+		if (!start)
 			return 0;
-		if (!h.m_chars_count)
-			h.m_chars_count = 1;
-		memcpy(h.m_chars + h.m_chars_count, string, length);
-		json_node start = h.m_chars_count;
-		h.m_chars_count += length;
+		memcpy(chars(h, start), id ? chars(h, id) : string, length);
 		return start;
 	}
-	inline static json_node alloc_node(json_heap& h, json_node object, json_node name) noexcept {
-		if (!h.reserve_nodes(1))
-			return 0;
-		json_node node = ++h.m_values_count;
-		h.m_values[node].parent = object;
-		h.m_values[node].name = name;
-		h.m_values[node].next = 0;
-		json_node last = h.get_last(object);
-		if (last)
-			h.m_values[last].next = node;
-		else
-			h.m_values[object].object_or_array.first = node;
-		h.m_values[object].object_or_array.last = node;
-		return node;
+	inline static json_node alloc_id(json_heap& h) noexcept {
+		//removed nodes are reused before the pool grows, unless a mark needs new nodes above it.
+		if (h.m_free && !h.m_marks) {
+			json_node node = h.m_free;
+			h.m_free = value(h, node).next;
+			return node;
+		}
+		if (h.m_values_count + 1u >= h.m_values_capacity) {
+			//contiguous pools double so appends stay amortized constant time; chunked pools already grow a chunk at a time.
+			uint32_t batch = h.m_storage == json_storage_chunked ? 1u : std::max(h.m_values_count, 16u);
+			if (!h.reserve_nodes(batch) && !h.reserve_nodes(1))
+				return 0;
+		}
+		return ++h.m_values_count;
 	}
-	inline static json_node alloc_node(json_heap& h, json_node array) noexcept {
-		if (!h.reserve_nodes(1))
+	inline static json_node alloc_node(json_heap& h, json_node parent, json_node name) noexcept {
+		//the parent is trusted to be a resolved object or array, so appending only touches its last child.
+		json_node node = alloc_id(h);
+		if (!node)
 			return 0;
-		json_node node = ++h.m_values_count;
-		h.m_values[node].parent = array;
-		h.m_values[node].name = 0;
-		h.m_values[node].next = 0;
-		json_node last = h.get_last(array);
-		if (last)
-			h.m_values[last].next = node;
+		invalidate(h, parent);
+		json_value& v = value(h, node);
+		v.parent = parent;
+		v.name = name;
+		v.next = 0;
+		v.lazy = false;
+		v.shape = 0;
+		json_value& p = value(h, parent);
+		if (p.object_or_array.last)
+			value(h, p.object_or_array.last).next = node;
 		else
-			h.m_values[array].object_or_array.first = node;
-		h.m_values[array].object_or_array.last = node;
+			p.object_or_array.first = node;
+		p.object_or_array.last = node;
 		return node;
 	}
 	inline static json_node alloc_node(json_heap& h) noexcept {
-		if (!h.reserve_nodes(1))
+		json_node node = alloc_id(h);
+		if (!node)
 			return 0;
-		json_node node = ++h.m_values_count;
-		h.m_values[node].parent = 0;
-		h.m_values[node].name = 0;
-		h.m_values[node].next = 0;
+		value(h, node).parent = 0;
+		value(h, node).name = 0;
+		value(h, node).next = 0;
+		value(h, node).lazy = false;
+		value(h, node).shape = 0;
 		return node;
 	}
+	inline static json_node alloc_member(json_heap& h, json_node object, json_string name) noexcept {
+		if (!h.is_object(object) || !resolve(h, object))
+			return 0;
+		json_node chars = alloc_string(h, name);
+		if (!chars)
+			return 0;
+		return alloc_node(h, object, chars);
+	}
+	inline static json_node alloc_element(json_heap& h, json_node array) noexcept {
+		if (!h.is_array(array) || !resolve(h, array))
+			return 0;
+		return alloc_node(h, array, 0);
+	}
 
-	inline static void dump_clear(json_heap& h) noexcept {
-		h.m_dump_count = 0;
+	inline static bool is_container(const json_value& v) noexcept {
+		return !v.lazy && (v.type == json_type_object || v.type == json_type_array);
+	}
+	inline static void free_node(json_heap& h, json_node node) noexcept {
+		if (node < h.m_hashes_capacity)
+			h.m_hashes[node] = 0;
+		json_value& v = value(h, node);
+		v.type = json_type_invalid;
+		v.lazy = false;
+		v.parent = 0;
+		v.next = h.m_free;
+		h.m_free = node;
+	}
+	inline static void free_children(json_heap& h, json_node node) noexcept {
+		//frees in postorder so each node's links are read before it joins the free list.
+		if (!is_container(value(h, node)))
+			return;
+		json_node curr = value(h, node).object_or_array.first;
+		value(h, node).object_or_array = {};
+		while (curr) {
+			json_value& v = value(h, curr);
+			if (is_container(v) && v.object_or_array.first) {
+				curr = v.object_or_array.first;
+				continue;
+			}
+			json_node next = v.next;
+			json_node parent = v.parent;
+			free_node(h, curr);
+			if (next)
+				curr = next;
+			else if (parent != node) {
+				value(h, parent).object_or_array.first = 0;
+				curr = parent;
+			}
+			else
+				curr = 0;
+		}
+	}
+	inline static json_node find_prev(const json_heap& h, json_node node) noexcept {
+		//siblings are singly linked so the previous sibling is found from the parent.
+		json_node prev = 0;
+		json_node curr = value(h, value(h, node).parent).object_or_array.first;
+		while (curr != node) {
+			prev = curr;
+			curr = value(h, curr).next;
+		}
+		return prev;
+	}
+	inline static void unlink(json_heap& h, json_node node) noexcept {
+		json_node parent = value(h, node).parent;
+		if (!parent)
+			return;
+		invalidate(h, parent);
+		json_node prev = find_prev(h, node);
+		json_node next = value(h, node).next;
+		if (prev)
+			value(h, prev).next = next;
+		else
+			value(h, parent).object_or_array.first = next;
+		if (value(h, parent).object_or_array.last == node)
+			value(h, parent).object_or_array.last = prev;
+		value(h, node).parent = 0;
+		value(h, node).next = 0;
+	}
+	inline static void link_last(json_heap& h, json_node node, json_node parent) noexcept {
+		invalidate(h, parent);
+		json_node last = value(h, parent).object_or_array.last;
+		if (last)
+			value(h, last).next = node;
+		else
+			value(h, parent).object_or_array.first = node;
+		value(h, parent).object_or_array.last = node;
+		value(h, node).parent = parent;
+		value(h, node).next = 0;
+	}
+	inline static void link_before(json_heap& h, json_node node, json_node sibling) noexcept {
+		json_node parent = value(h, sibling).parent;
+		invalidate(h, parent);
+		json_node prev = find_prev(h, sibling);
+		if (prev)
+			value(h, prev).next = node;
+		else
+			value(h, parent).object_or_array.first = node;
+		value(h, node).parent = parent;
+		value(h, node).next = sibling;
+	}
+	inline static bool is_ancestor(const json_heap& h, json_node node, json_node descendant) noexcept {
+		for (json_node curr = descendant; curr; curr = value(h, curr).parent)
+			if (curr == node)
+				return true;
+		return false;
+	}
+	inline static json_node set_chars(json_heap& h, json_node id, json_string value) noexcept {
+		//strings are never shared between nodes, so a string that fits is overwritten in place.
+		size_t length = strlen(value);
+		if (id && strlen(chars(h, id)) >= length) {
+			memmove(chars(h, id), value, length + 1);
+			return id;
+		}
+		return alloc_string(h, value);
+	}
+	inline static bool set_value(json_heap& h, json_node node, json_type type) noexcept {
+		//a replaced container releases its children; a lazy node simply forgets its source.
+		if (h.is_invalid(node))
+			return false;
+		invalidate(h, node);
+		free_children(h, node);
+		value(h, node).lazy = false;
+		value(h, node).type = type;
+		return true;
 	}
-	inline static bool dump_pad(json_heap& h, size_t d) {
-		size_t d2 = d + d;
-		if (!dump_grow(h, d2))
+
+	inline static bool reserve_text(json_char*& text, size_t& capacity, size_t required) noexcept {
+		if (required <= capacity)
+			return true;
+		size_t grown = std::max(required, capacity + capacity / 2u);
+		json_char* data = (json_char*)realloc(text, grown * sizeof(json_char));
+		if (!data)
 			return false;
-		memset(h.m_dump + h.m_dump_count, ' ', d2);
-		h.m_dump_count += d2;
+		text = data;
+		capacity = grown;
 		return true;
 	}
+	inline static bool read_gzip(json_string path, size_t hint, json_char*& text, size_t& capacity, size_t& length) noexcept {
+#ifdef NIXIE_JSON_ZLIB
+		//the file is decompressed through a small window, so the compressed text is never held in memory.
+		gzFile file = gzopen(path, "rb");
+		if (!file)
+			return false;
+		gzbuffer(file, 1u << 17);
+		size_t block = hint + 1u;
+		bool read = true;
+		while (true) {
+			unsigned chunk = unsigned(std::min<size_t>(block, 1u << 30));
+			if (!reserve_text(text, capacity, length + chunk)) {
+				read = false;
+				break;
+			}
+			int count = gzread(file, text + length, chunk);
+			if (count < 0) {
+				read = false;
+				break;
+			}
+			length += size_t(count);
+			if (unsigned(count) < chunk) {
+				//truncated files end early with an error.
+				int error = Z_OK;
+				gzerror(file, &error);
+				read = error == Z_OK;
+				break;
+			}
+			block = 65536u;
+		}
+		gzclose(file);
+		return read;
+#else
+		(void)path, (void)hint, (void)text, (void)capacity, (void)length;
+		return false;
+#endif
+	}
+	inline static bool read_file(json_string path, json_char*& text, size_t& capacity, size_t& length) noexcept {
+		//the buffer is kept by the caller so it can be reused for the next file.
+		length = 0;
+		try {
+			std::ifstream stream(path, std::ios::binary);
+			if (!stream.good())
+				return false;
+			std::streamoff end = stream.seekg(0, std::ios::end).tellg();
+			stream.seekg(0, std::ios::beg);
+			if (!stream.good()) {
+				//streams that cannot seek, like pipes, report no size and are read in blocks until they end.
+				stream.clear();
+				end = -1;
+			}
+			//directories report the largest offset on some systems.
+			if (end == std::numeric_limits<std::streamoff>::max() || (end >= 0 && uint64_t(end) >= std::numeric_limits<size_t>::max()))
+				return false;
+			if (end >= 18) {
+				//gzip files start with 1f 8b and end with the decompressed size of their last member, which presizes the buffer.
+				unsigned char header[2];
+				unsigned char trailer[4];
+				stream.read((char*)header, 2);
+				stream.seekg(end - 4, std::ios::beg);
+				stream.read((char*)trailer, 4);
+				stream.seekg(0, std::ios::beg);
+				if (!stream.good())
+					return false;
+				if (header[0] == 0x1fu && header[1] == 0x8bu) {
+					//the trailer is not trusted. deflate expands at most 1032 times, and larger files grow in blocks past a fixed bound.
+					size_t hint = size_t(trailer[0]) | size_t(trailer[1]) << 8 | size_t(trailer[2]) << 16 | size_t(trailer[3]) << 24;
+					hint = size_t(std::min<uint64_t>({ uint64_t(hint), uint64_t(end) * 1032u, uint64_t(1) << 26 }));
+					stream.close();
+					return read_gzip(path, hint, text, capacity, length);
+				}
+			}
+			//one char more than the size is requested so a file that did not grow ends on the first read.
+			size_t block = end >= 0 ? size_t(end) + 1u : 65536u;
+			while (true) {
+				if (!reserve_text(text, capacity, length + block))
+					return false;
+				stream.read(text + length, std::streamsize(block));
+				length += size_t(stream.gcount());
+				if (!stream.good())
+					return stream.eof() && !stream.bad();
+				block = 65536u;
+			}
+		}
+		catch (...) {
+			return false;
+		}
+	}
+	inline static bool write_gzip(json_string path, const json_char* text, size_t length) noexcept {
+#ifdef NIXIE_JSON_ZLIB
+		gzFile file = gzopen(path, "wb");
+		if (!file)
+			return false;
+		gzbuffer(file, 1u << 17);
+		bool written = true;
+		while (length && written) {
+			unsigned chunk = unsigned(std::min<size_t>(length, 1u << 30));
+			written = gzwrite(file, text, chunk) == int(chunk);
+			text += chunk;
+			length -= chunk;
+		}
+		return gzclose(file) == Z_OK && written;
+#else
+		(void)path, (void)text, (void)length;
+		return false;
+#endif
+	}
+	inline static bool write_file(json_string path, const json_char* text, size_t length, json_compression compression) noexcept {
+		if (compression == json_compression_gzip)
+			return write_gzip(path, text, length);
+		if (compression != json_compression_none)
+			return false;
+		try {
+			std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+			if (!stream.good())
+				return false;
+			stream.write(text, std::streamsize(length));
+			stream.close();
+			return !stream.fail();
+		}
+		catch (...) {
+			return false;
+		}
+	}
+
+	inline static void dump_clear(json_heap& h) noexcept {
+		h.m_dump_count = 0;
+	}
 	inline static bool dump_grow(json_heap& h, size_t l) noexcept {
 		size_t capacity = h.m_dump_count + l;
 		if (capacity > h.m_dump_capacity) {
@@ -113,7 +780,8 @@ struct nix::json_heap::json_utils {
 			json_char* dump = (json_char*)malloc(capacity * sizeof(json_char));
 			if (!dump)
 				return false;
-			memcpy(dump, h.m_dump, h.m_dump_count * sizeof(json_char));
+			if (h.m_dump_count)
+				memcpy(dump, h.m_dump, h.m_dump_count * sizeof(json_char));
 			free(h.m_dump);
 			h.m_dump = dump;
 			h.m_dump_capacity = capacity;
@@ -126,17 +794,51 @@ struct nix::json_heap::json_utils {
 		h.m_dump[h.m_dump_count++] = c;
 		return true;
 	}
-	inline static bool dump_number(json_heap& h, json_number n) noexcept {
-		int r = snprintf(h.m_dump + h.m_dump_count, h.m_dump_capacity - h.m_dump_count, "%f", n);
-		if (r >= (h.m_dump_capacity - h.m_dump_count)) {
-			if (!dump_grow(h, r))
-				return false;
-			snprintf(h.m_dump + h.m_dump_count, h.m_dump_capacity - h.m_dump_count, "%f", n);
+	inline static uint32_t format_number(json_number n, json_char* out) noexcept {
+		//out must hold number_chars. the fraction's trailing zeros are trimmed.
+		json_number scaled = n * 1e6;
+		if (scaled > -4503599627370496.0 && scaled < 4503599627370496.0 && scaled == json_number(int64_t(scaled))) {
+			//below 2^52 the product is within a quarter of the exact one, so it is what "%f" rounds to and can be written without snprintf.
+			uint64_t bits;
+			memcpy(&bits, &n, sizeof(bits));
+			int64_t whole = int64_t(scaled);
+			uint64_t digits = uint64_t(whole < 0 ? -whole : whole);
+			uint32_t fraction = uint32_t(digits % 1000000u);
+			json_char text[24];
+			json_char* end = text + sizeof(text);
+			json_char* c = end;
+			if (fraction) {
+				uint32_t places = 6;
+				while (fraction % 10u == 0)
+					fraction /= 10u, --places;
+				for (uint32_t i = 0; i < places; ++i, fraction /= 10u)
+					*--c = json_char('0' + fraction % 10u);
+				*--c = '.';
+			}
+			digits /= 1000000u;
+			do {
+				*--c = json_char('0' + digits % 10u);
+				digits /= 10u;
+			} while (digits);
+			if (bits >> 63)
+				*--c = '-';
+			memcpy(out, c, size_t(end - c));
+			return uint32_t(end - c);
 		}
-		json_string s = h.m_dump + h.m_dump_count - 1;
-		while (s[r] == '0') --r;
-		if (s[r] == '.') --r;
-		h.m_dump_count += r;
+		int r = snprintf(out, number_chars, "%f", n);
+		if (r <= 0 || r >= int(number_chars))
+			return 0;
+		while (out[r - 1] == '0') --r;
+		if (out[r - 1] == '.') --r;
+		return uint32_t(r);
+	}
+	inline static bool dump_number(json_heap& h, json_number n) noexcept {
+		json_char text[number_chars];
+		uint32_t length = format_number(n, text);
+		if (!length || !dump_grow(h, length))
+			return false;
+		memcpy(h.m_dump + h.m_dump_count, text, length);
+		h.m_dump_count += length;
 		return true;
 	}
 	inline static bool dump_string(json_heap& h, json_string s) noexcept {
@@ -148,12 +850,21 @@ struct nix::json_heap::json_utils {
 		return true;
 	}
 	inline static bool dump_string_escaped(json_heap& h, json_string s) noexcept {
+		static constexpr json_char hex[] = "0123456789abcdef";
 		while (*s != '\0') {
-			if (!dump_grow(h, 2))
+			if (!dump_grow(h, 6))
 				return false;
-			if (escapes[*s]) {
+			uint8_t c = uint8_t(*s);
+			if (escapes[c]) {
 				h.m_dump[h.m_dump_count++] = '\\';
-				h.m_dump[h.m_dump_count++] = escapes[*s];
+				h.m_dump[h.m_dump_count++] = escapes[c];
+			}
+			else if (c < 0x20u) {
+				//control chars without a short escape are written as \u00##.
+				memcpy(h.m_dump + h.m_dump_count, "\\u00", 4);
+				h.m_dump[h.m_dump_count + 4] = hex[c >> 4];
+				h.m_dump[h.m_dump_count + 5] = hex[c & 15u];
+				h.m_dump_count += 6;
 			}
 			else {
 				h.m_dump[h.m_dump_count++] = *s;
@@ -162,691 +873,4221 @@ struct nix::json_heap::json_utils {
 		}
 		return true;
 	}
+	inline static size_t escaped_length(json_string s) noexcept {
+		//matches dump_string_escaped.
+		size_t length = 0;
+		for (; *s; ++s)
+			length += escapes[uint8_t(*s)] ? 2u : uint8_t(*s) < 0x20u ? 6u : 1u;
+		return length;
+	}
 	inline static bool dump_string_dscaped(json_heap& h, json_string& s, json_char e) noexcept {
 		while (*s && *s != e) {
-			if (!dump_grow(h, 2))
+			if (!dump_grow(h, 4))
 				return false;
 			if (*s == '\\') {
-				if (dscapes[*++s])
-					h.m_dump[h.m_dump_count++] = dscapes[*s];
-				else
+				uint32_t length = decode_escape(++s, h.m_dump + h.m_dump_count);
+				if (!length)
 					return false;
+				h.m_dump_count += length;
 			}
 			else {
-				h.m_dump[h.m_dump_count++] = *s;
+				h.m_dump[h.m_dump_count++] = *s++;
 			}
-			++s;
 		}
 		return *s++ == e;
-		return true;
 	}
 
-	inline static bool is_whitespace(json_char character) noexcept {
-		return character == ' ' || character == '\t' || character == '\n';
+	inline static uint32_t decode_hex(json_string s) noexcept {
+		//returns a value above 0xffff if the digits are malformed.
+		uint32_t code = 0;
+		for (uint32_t i = 0; i < 4; ++i) {
+			json_char c = s[i];
+			json_char l = json_char(c | 0x20);
+			if (c >= '0' && c <= '9')
+				code = (code << 4) | uint32_t(c - '0');
+			else if (l >= 'a' && l <= 'f')
+				code = (code << 4) | uint32_t(l - 'a' + 10);
+			else
+				return std::numeric_limits<uint32_t>::max();
+		}
+		return code;
 	}
-	inline static bool do_whitespace(json_string& source) noexcept {
-		size_t s = 0;
-		while (source[s] && is_whitespace(source[s])) ++s;
-		source += s;
-		return *source;
+	inline static uint32_t encode_utf8(uint32_t code, json_char* out) noexcept {
+		if (code < 0x80u) {
+			out[0] = json_char(code);
+			return 1;
+		}
+		if (code < 0x800u) {
+			out[0] = json_char(0xC0u | (code >> 6));
+			out[1] = json_char(0x80u | (code & 0x3Fu));
+			return 2;
+		}
+		if (code < 0x10000u) {
+			out[0] = json_char(0xE0u | (code >> 12));
+			out[1] = json_char(0x80u | ((code >> 6) & 0x3Fu));
+			out[2] = json_char(0x80u | (code & 0x3Fu));
+			return 3;
+		}
+		out[0] = json_char(0xF0u | (code >> 18));
+		out[1] = json_char(0x80u | ((code >> 12) & 0x3Fu));
+		out[2] = json_char(0x80u | ((code >> 6) & 0x3Fu));
+		out[3] = json_char(0x80u | (code & 0x3Fu));
+		return 4;
 	}
-
-	inline static nix::json_node load_pretty(json_heap& heap, json_string& source) noexcept {
-		do_whitespace(source);
-		//boolean
-		if (strncmp(source, "true", 4) == 0) {
-			source += 4;
-			return heap.new_boolean(true);
-		}
-		if (strncmp(source, "false", 5) == 0) {
-			source += 5;
-			return heap.new_boolean(false);
-		}
-		//number
-		char* endptr;
-		json_number number = strtod(source, &endptr);
-		if (source != endptr) {
-			source = endptr;
-			return heap.new_number(number);
-		}
-		//string
-		if (*source == '"') {
-			dump_clear(heap);
-			if (!dump_string_dscaped(heap, ++source, '"')) return 0;
-			if (!dump_char(heap, '\0')) return 0;
-			return heap.new_string(heap.m_dump);
-		}
-		//object
-		if (*source == '{') {
-			json_node node = heap.new_object();
-			json_node last = 0;
-			if (!do_whitespace(++source)) return 0;
-			if (*source == '}') {
-				++source;
-				return node;
+	inline static uint32_t decode_escape(json_string& s, json_char* out) noexcept {
+		//expects the source after the backslash. writes at most four chars and never more than it reads.
+		json_char c = *s++;
+		if (c != 'u') {
+			out[0] = dscapes[uint8_t(c)];
+			return out[0] ? 1 : 0;
+		}
+		uint32_t code = decode_hex(s);
+		if (code > 0xFFFFu)
+			return 0;
+		s += 4;
+		if (code >= 0xD800u && code <= 0xDBFFu) {
+			if (s[0] != '\\' || s[1] != 'u')
+				return 0;
+			uint32_t low = decode_hex(s + 2);
+			if (low < 0xDC00u || low > 0xDFFFu)
+				return 0;
+			s += 6;
+			code = 0x10000u + ((code - 0xD800u) << 10) + (low - 0xDC00u);
+		}
+		else if (code >= 0xDC00u && code <= 0xDFFFu) {
+			return 0;
+		}
+		//json strings are null terminated so \u0000 cannot be represented.
+		if (!code)
+			return 0;
+		return encode_utf8(code, out);
+	}
+	inline static size_t utf8_length(const json_char* data, size_t length) noexcept {
+		//returns the length of the valid prefix.
+		const uint8_t* s = (const uint8_t*)data;
+		const uint8_t* e = s + length;
+		while (s < e) {
+			//skip ascii a block at a time; only multibyte sequences take the range checks below.
+#ifdef NIXIE_JSON_SSE2
+			while (e - s >= 16 && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)s)))
+				s += 16;
+#else
+			uint64_t block;
+			while (e - s >= 8 && (memcpy(&block, s, 8), !(block & 0x8080808080808080ull)))
+				s += 8;
+#endif
+			if (s == e)
+				return length;
+			uint8_t c = *s;
+			if (c < 0x80u) {
+				++s;
+				continue;
 			}
-			while (*source == '"') {
-				dump_clear(heap);
-				if (!do_whitespace(++source)) return 0;
-				if (!dump_string_dscaped(heap, source, '"')) return 0;
-				if (!dump_char(heap, '\0')) return 0;
-				if (*source++ != ':') return 0;
-				json_node name = alloc_string(heap, heap.m_dump);
-				json_node child = load_pretty(heap, source);
-				if (!child) return 0;
-				heap.m_values[child].name = name;
-				heap.m_values[child].parent = node;
-				heap.m_values[node].object_or_array.last = child;
-				if (last)
-					heap.m_values[last].next = child;
-				else
-					heap.m_values[node].object_or_array.first = child;
-				last = child;
-				if (!do_whitespace(source)) return 0;
-				json_char character = *source++;
-				if (character == '}') return node;
-				if (character != ',') return 0;
-				if (!do_whitespace(source)) return 0;
-			}
-		}
-		//array
-		if (*source == '[') {
-			json_node node = heap.new_array();
-			json_node last = 0;
-			if (!do_whitespace(++source)) return 0;
-			if (*source == ']') {
-				++source;
-				return node;
+			//the valid ranges of the second byte depend on the first byte.
+			size_t n;
+			uint8_t lo = 0x80u;
+			uint8_t hi = 0xBFu;
+			if (c >= 0xC2u && c <= 0xDFu) {
+				n = 1;
 			}
-			while (true) {
-				json_node child = load_pretty(heap, source);
-				if (!child) return 0;
-				heap.m_values[child].parent = node;
-				heap.m_values[node].object_or_array.last = child;
-				if (last)
-					heap.m_values[last].next = child;
-				else
-					heap.m_values[node].object_or_array.first = child;
-				last = child;
-				if (!do_whitespace(source)) return 0;
-				json_char character = *source++;
-				if (character == ']') return node;
-				if (character != ',') return 0;
-			}
-		}
-		//null
-		if (strncmp(source, "null", 4) == 0) {
-			source += 4;
-			return heap.new_null();
-		}
-		return 0;
-	}
-	inline static nix::json_node load_dense(json_heap& heap, json_string& source) noexcept {
-		//boolean
-		if (strncmp(source, "true", 4) == 0) {
-			source += 4;
-			return heap.new_boolean(true);
-		}
-		if (strncmp(source, "false", 5) == 0) {
-			source += 5;
-			return heap.new_boolean(false);
-		}
-		//number
-		char* endptr;
-		json_number number = strtod(source, &endptr);
-		if (source != endptr) {
-			source = endptr;
-			return heap.new_number(number);
-		}
-		//string
-		if (*source == '"') {
-			dump_clear(heap);
-			if (!dump_string_dscaped(heap, ++source, '"')) return 0;
-			if (!dump_char(heap, '\0')) return 0;
-			return heap.new_string(heap.m_dump);
-		}
-		//object
-		if (*source == '{') {
-			json_node node = heap.new_object();
-			json_node last = 0;
-			if (*++source == '}') {
-				++source;
-				return node;
+			else if (c >= 0xE0u && c <= 0xEFu) {
+				n = 2;
+				if (c == 0xE0u) lo = 0xA0u;
+				if (c == 0xEDu) hi = 0x9Fu;
 			}
-			while (*source == '"') {
-				dump_clear(heap);
-				if (!dump_string_dscaped(heap, ++source, '"')) return 0;
-				if (!dump_char(heap, '\0')) return 0;
-				if (*source++ != ':') return 0;
-				json_node name = alloc_string(heap, heap.m_dump);
-				json_node child = load_dense(heap, source);
-				if (!child) return 0;
-				heap.m_values[child].name = name;
-				heap.m_values[child].parent = node;
-				heap.m_values[node].object_or_array.last = child;
-				if (last)
-					heap.m_values[last].next = child;
-				else
-					heap.m_values[node].object_or_array.first = child;
-				last = child;
-				json_char character = *source++;
-				if (character == '}') return node;
-				if (character != ',') return 0;
-			}
-		}
-		//array
-		if (*source == '[') {
-			json_node node = heap.new_array();
-			json_node last = 0;
-			if (*++source == ']') {
-				++source;
-				return node;
+			else if (c >= 0xF0u && c <= 0xF4u) {
+				n = 3;
+				if (c == 0xF0u) lo = 0x90u;
+				if (c == 0xF4u) hi = 0x8Fu;
 			}
-			while (true) {
-				json_node child = load_dense(heap, source);
-				if (!child) return 0;
-				heap.m_values[child].parent = node;
-				heap.m_values[node].object_or_array.last = child;
-				if (last)
-					heap.m_values[last].next = child;
-				else
-					heap.m_values[node].object_or_array.first = child;
-				last = child;
-				json_char character = *source++;
-				if (character == ']') return node;
-				if (character != ',') return 0;
+			else {
+				return size_t(s - (const uint8_t*)data);
 			}
+			if (size_t(e - s) <= n || s[1] < lo || s[1] > hi)
+				return size_t(s - (const uint8_t*)data);
+			for (size_t i = 2; i <= n; ++i)
+				if ((s[i] & 0xC0u) != 0x80u)
+					return size_t(s - (const uint8_t*)data);
+			s += n + 1;
 		}
-		//null
-		if (strncmp(source, "null", 4) == 0) {
-			source += 4;
-			return heap.new_null();
+		return length;
+	}
+	inline static bool is_utf8(const json_char* data, size_t length) noexcept {
+		return utf8_length(data, length) == length;
+	}
+
+	static constexpr uint32_t max_depth = 1024u;
+	static constexpr uint32_t number_chars = 352u;
+
+	inline static uint32_t first_bit(uint32_t mask) noexcept {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return uint32_t(index);
+#else
+		return uint32_t(__builtin_ctz(mask));
+#endif
+	}
+	inline static constexpr uint64_t zero_bytes(uint64_t x) noexcept {
+		//sets the high bit of every byte that is zero. exact, unlike the borrow based trick.
+		return ~(((x & 0x7F7F7F7F7F7F7F7Fu) + 0x7F7F7F7F7F7F7F7Fu) | x | 0x7F7F7F7F7F7F7F7Fu);
+	}
+	inline static const json_char* scan_whitespace(const json_char* s, const json_char* e) noexcept {
+#ifdef NIXIE_JSON_SSE2
+		while (e - s >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)s);
+			__m128i w = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+			uint32_t mask = ~uint32_t(_mm_movemask_epi8(w)) & 0xFFFFu;
+			if (mask)
+				return s + first_bit(mask);
+			s += 16;
 		}
-		return 0;
+#else
+		while (e - s >= 8) {
+			//swar: a byte is whitespace if xoring it with one of the four whitespace chars gives zero.
+			uint64_t v;
+			memcpy(&v, s, 8);
+			uint64_t w = zero_bytes(v ^ 0x2020202020202020u) | zero_bytes(v ^ 0x0909090909090909u)
+				| zero_bytes(v ^ 0x0A0A0A0A0A0A0A0Au) | zero_bytes(v ^ 0x0D0D0D0D0D0D0D0Du);
+			if (w != 0x8080808080808080u)
+				break;
+			s += 8;
+		}
+#endif
+		while (s < e && (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')) ++s;
+		return s;
 	}
-	inline static bool save_pretty(json_heap& heap, json_node source, size_t d = 0) noexcept {
-		json_type type = heap.get_type(source);
-		if (type == json_type_boolean) {
-			if (heap.to_boolean(source))
-				dump_string(heap, "true");
-			else
-				dump_string(heap, "false");
-			return true;
+	inline static const json_char* skip_whitespace(const json_char* s, const json_char* e) noexcept {
+		//minified text has no whitespace between tokens, so one compare usually skips the scan.
+		return s < e && uint8_t(*s) > ' ' ? s : scan_whitespace(s, e);
+	}
+	inline static const json_char* scan_string(const json_char* s, const json_char* e) noexcept {
+		//expects the source after the opening quote. returns the closing quote.
+		while (true) {
+#ifdef NIXIE_JSON_SSE2
+			while (e - s >= 16) {
+				__m128i v = _mm_loadu_si128((const __m128i*)s);
+				__m128i special = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+					_mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F)));
+				uint32_t mask = uint32_t(_mm_movemask_epi8(special));
+				if (mask) {
+					s += first_bit(mask);
+					break;
+				}
+				s += 16;
+			}
+#endif
+			if (s >= e)
+				return 0;
+			uint8_t c = uint8_t(*s);
+			if (c == '"')
+				return s;
+			if (c < 0x20u)
+				return 0;
+			if (c == '\\') {
+				if (++s >= e)
+					return 0;
+				if (*s == 'u') {
+					//\u0000 and unpaired surrogates are rejected like the loader does, since strings are null terminated utf8.
+					uint32_t code = e - s > 4 ? decode_hex(s + 1) : 0u;
+					if (code - 1u >= 0xFFFFu || (code >= 0xDC00u && code <= 0xDFFFu))
+						return 0;
+					s += 4;
+					if (code >= 0xD800u && code <= 0xDBFFu) {
+						if (e - s <= 6 || s[1] != '\\' || s[2] != 'u')
+							return 0;
+						uint32_t low = decode_hex(s + 3);
+						if (low < 0xDC00u || low > 0xDFFFu)
+							return 0;
+						s += 6;
+					}
+				}
+				else if (!dscapes[uint8_t(*s)]) {
+					return 0;
+				}
+			}
+			++s;
 		}
-		if (type == json_type_number) {
-			return dump_number(heap, heap.to_number(source));
+	}
+	inline static const json_char* scan_number(const json_char* s, const json_char* e) noexcept {
+		if (s < e && *s == '-') ++s;
+		if (s == e) return 0;
+		if (*s == '0') ++s;
+		else if (*s >= '1' && *s <= '9') while (++s < e && *s >= '0' && *s <= '9');
+		else return 0;
+		if (s < e && *s == '.') {
+			const json_char* d = ++s;
+			while (s < e && *s >= '0' && *s <= '9') ++s;
+			if (s == d) return 0;
 		}
-		if (type == json_type_string) {
-			return dump_char(heap, '\"') && dump_string_escaped(heap, heap.to_string(source)) && dump_char(heap, '\"');
+		if (s < e && (*s == 'e' || *s == 'E')) {
+			if (++s < e && (*s == '+' || *s == '-')) ++s;
+			const json_char* d = s;
+			while (s < e && *s >= '0' && *s <= '9') ++s;
+			if (s == d) return 0;
 		}
-		if (type == json_type_object) {
-			if (!dump_char(heap, '{')) return false;
-			json_node curr = heap.get_first(source);
-			json_node last = heap.get_last(source);
-			while (curr) {
-				if (!dump_char(heap, '\n')) return false;
-				if (!dump_pad(heap, d + 1)) return false;
-				if (!dump_char(heap, '\"')) return false;
-				if (!dump_string_escaped(heap, heap.get_name(curr))) return false;
-				if (!dump_string(heap, "\": ")) return false;
-				if (!save_pretty(heap, curr, d + 1)) return false;
-				if (curr != last && !dump_char(heap, ',')) return false;
-				curr = heap.get_next(curr);
-			}
-			if (last) {
-				if (!dump_char(heap, '\n')) return false;
-				if (!dump_pad(heap, d)) return false;
-			}
-			if (!dump_char(heap, '}')) return false;
-			return true;
+		return s;
+	}
+	inline static const json_char* scan_literal(const json_char* s, const json_char* e) noexcept {
+		if (e - s >= 4 && (memcmp(s, "true", 4) == 0 || memcmp(s, "null", 4) == 0))
+			return s + 4;
+		if (e - s >= 5 && memcmp(s, "false", 5) == 0)
+			return s + 5;
+		return 0;
+	}
+	template<bool minify>
+	inline static const json_char* scan_emit(const json_char* s, const json_char* end, json_char*& out) noexcept {
+		//minified output never outgrows the source, so it may overwrite the source in place.
+		if (minify) {
+			memmove(out, s, size_t(end - s) * sizeof(json_char));
+			out += end - s;
 		}
-		if (type == json_type_array) {
-			if (!dump_char(heap, '[')) return false;
-			json_node curr = heap.get_first(source);
-			json_node last = heap.get_last(source);
-			while (curr) {
-				if (!dump_char(heap, '\n')) return false;
-				if (!dump_pad(heap, d + 1)) return false;
-				if (!save_pretty(heap, curr, d + 1)) return false;
-				if (curr != last && !dump_char(heap, ',')) return false;
-				curr = heap.get_next(curr);
+		return end;
+	}
+	template<bool minify>
+	inline static const json_char* scan_key(const json_char* s, const json_char* e, json_char*& out) noexcept {
+		if (s == e || *s != '"')
+			return 0;
+		const json_char* quote = scan_string(s + 1, e);
+		if (!quote)
+			return 0;
+		scan_emit<minify>(s, quote + 1, out);
+		s = scan_whitespace(quote + 1, e);
+		if (s == e || *s != ':')
+			return 0;
+		return scan_emit<minify>(s, s + 1, out);
+	}
+	template<bool minify>
+	inline static const json_char* scan_value(const json_char* s, const json_char* e, json_char*& out) noexcept {
+		//walks the grammar of one value without making nodes. one bit per depth remembers whether the container is an object.
+		uint64_t objects[max_depth / 64u] = {};
+		uint32_t depth = 0;
+		bool value = true;
+		while (true) {
+			if (!value && !depth)
+				return s;
+			s = scan_whitespace(s, e);
+			if (value) {
+				if (s == e)
+					return 0;
+				json_char c = *s;
+				const json_char* end;
+				if (c == '{' || c == '[') {
+					if (depth == max_depth)
+						return 0;
+					if (c == '{')
+						objects[depth >> 6] |= uint64_t(1) << (depth & 63u);
+					else
+						objects[depth >> 6] &= ~(uint64_t(1) << (depth & 63u));
+					++depth;
+					s = scan_whitespace(scan_emit<minify>(s, s + 1, out), e);
+					if (s < e && *s == (c == '{' ? '}' : ']')) {
+						s = scan_emit<minify>(s, s + 1, out);
+						--depth;
+						value = false;
+					}
+					else if (c == '{' && !(s = scan_key<minify>(s, e, out))) {
+						return 0;
+					}
+					continue;
+				}
+				if (c == '"') {
+					if ((end = scan_string(s + 1, e)))
+						++end;
+				}
+				else if (c == 't' || c == 'f' || c == 'n')
+					end = scan_literal(s, e);
+				else
+					end = scan_number(s, e);
+				if (!end)
+					return 0;
+				s = scan_emit<minify>(s, end, out);
+				value = false;
+				continue;
 			}
-			if (last) {
-				if (!dump_char(heap, '\n')) return false;
-				if (!dump_pad(heap, d)) return false;
+			if (s == e)
+				return 0;
+			bool object = (objects[(depth - 1) >> 6] >> ((depth - 1) & 63u)) & 1u;
+			if (*s == ',') {
+				s = scan_whitespace(scan_emit<minify>(s, s + 1, out), e);
+				if (object && !(s = scan_key<minify>(s, e, out)))
+					return 0;
+				value = true;
+				continue;
 			}
-			if (!dump_char(heap, ']')) return false;
-			return true;
-		}
-		if (type == json_type_null) {
-			return dump_string(heap, "null");
+			if (*s != (object ? '}' : ']'))
+				return 0;
+			s = scan_emit<minify>(s, s + 1, out);
+			--depth;
 		}
-		return false;
 	}
-	inline static bool save_dense(json_heap& heap, json_node source) noexcept {
-		json_type type = heap.get_type(source);
-		if (type == json_type_boolean) {
-			if (heap.to_boolean(source))
-				dump_string(heap, "true");
-			else
-				dump_string(heap, "false");
-			return true;
+	template<bool minify>
+	inline static const json_char* scan(const json_char* s, const json_char* e, json_char*& out) noexcept {
+		s = scan_value<minify>(s, e, out);
+		if (!s)
+			return 0;
+		s = scan_whitespace(s, e);
+		return s == e ? s : 0;
+	}
+	inline static json_number scan_double(const json_char* s, const json_char* end) noexcept {
+		//expects a number checked by scan_number. up to 2^53 with a small power of ten is exact in doubles, so one multiply or divide rounds correctly.
+		static constexpr json_number powers[23] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		const json_char* c = s;
+		bool negative = *c == '-';
+		if (negative)
+			++c;
+		uint64_t mantissa = 0;
+		int32_t digits = 0;
+		int32_t exponent = 0;
+		for (; c < end && *c >= '0' && *c <= '9'; ++c, ++digits)
+			mantissa = mantissa * 10u + uint64_t(*c - '0');
+		if (c < end && *c == '.')
+			for (++c; c < end && *c >= '0' && *c <= '9'; ++c, ++digits, --exponent)
+				mantissa = mantissa * 10u + uint64_t(*c - '0');
+		if (c < end) {
+			bool minus = *++c == '-';
+			if (*c == '+' || *c == '-')
+				++c;
+			int32_t power = 0;
+			for (; c < end && power < 100000; ++c)
+				power = power * 10 + (*c - '0');
+			exponent += minus ? -power : power;
 		}
-		if (type == json_type_number) {
-			return dump_number(heap, heap.to_number(source));
+		if (digits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+			json_number number = exponent < 0 ? json_number(mantissa) / powers[-exponent] : json_number(mantissa) * powers[exponent];
+			return negative ? -number : number;
+		}
+		//everything else goes through strtod, which needs a terminated copy.
+		json_char local[64];
+		size_t length = size_t(end - s);
+		json_char* copy = length < sizeof(local) ? local : (json_char*)malloc(length + 1u);
+		if (!copy)
+			return 0.0;
+		memcpy(copy, s, length);
+		copy[length] = '\0';
+		json_number number = strtod(copy, 0);
+		if (copy != local)
+			free(copy);
+		return number;
+	}
+
+	inline static json_char* decode_chars(const json_char* s, const json_char* end, json_char* out) noexcept {
+		//expects a string checked by scan_string. runs without escapes are copied whole.
+		while (s < end) {
+			const json_char* slash = (const json_char*)memchr(s, '\\', size_t(end - s));
+			if (!slash)
+				slash = end;
+			memcpy(out, s, size_t(slash - s));
+			out += slash - s;
+			s = slash;
+			if (s < end) {
+				json_string escape = s + 1;
+				uint32_t length = decode_escape(escape, out);
+				if (!length)
+					return 0;
+				out += length;
+				s = escape;
+			}
 		}
-		if (type == json_type_string) {
-			return dump_char(heap, '\"') && dump_string_escaped(heap, heap.to_string(source)) && dump_char(heap, '\"');
+		return out;
+	}
+	static constexpr uint16_t shape_dense = 0x8000u;
+	static constexpr uint32_t max_shapes = 0x7FFEu;
+	static constexpr uint32_t max_shape_keys = 64u;
+	static constexpr uint32_t max_names = 0x1000u;
+	static constexpr uint32_t max_name_length = 64u;
+
+	inline static uint32_t hash_key(const json_char* s, size_t length) noexcept {
+		uint64_t x = length;
+		for (; length >= 8u; s += 8, length -= 8u) {
+			uint64_t block;
+			memcpy(&block, s, 8);
+			x = (x ^ block) * 0x9e3779b97f4a7c15ull;
 		}
-		if (type == json_type_object) {
-			if (!dump_char(heap, '{')) return false;
-			json_node curr = heap.get_first(source);
-			json_node last = heap.get_last(source);
-			while (curr) {
-				if (!dump_char(heap, '\"')) return false;
-				if (!dump_string_escaped(heap, heap.get_name(curr))) return false;
-				if (!dump_string(heap, "\":")) return false;
-				if (!save_dense(heap, curr)) return false;
-				if (curr != last && !dump_char(heap, ',')) return false;
-				curr = heap.get_next(curr);
-			}
-			if (!dump_char(heap, '}')) return false;
-			return true;
+		uint64_t block = 0;
+		memcpy(&block, s, length);
+		return uint32_t(mix(x ^ block));
+	}
+	inline static uint32_t find_name(const json_heap& h, const json_shapes& s, const json_char* text, size_t length, uint32_t hash) noexcept {
+		//returns the index of the shared name plus one.
+		if (s.name_slots.empty())
+			return 0;
+		uint32_t mask = uint32_t(s.name_slots.size() - 1u);
+		for (uint32_t i = hash & mask;; i = (i + 1u) & mask) {
+			uint32_t slot = s.name_slots[i];
+			if (!slot)
+				return 0;
+			if ((slot ^ hash) >> 16)
+				continue;
+			slot &= 0xFFFFu;
+			const json_shapes::name& n = s.names[slot - 1u];
+			if (n.hash == hash && n.length == length && memcmp(chars(h, n.id), text, length) == 0)
+				return slot;
 		}
-		if (type == json_type_array) {
-			if (!dump_char(heap, '[')) return false;
-			json_node curr = heap.get_first(source);
-			json_node last = heap.get_last(source);
-			while (curr) {
-				if (!save_dense(heap, curr)) return false;
-				if (curr != last && !dump_char(heap, ',')) return false;
-				curr = heap.get_next(curr);
+	}
+	inline static uint32_t shared_name(const json_heap& h, json_node id) noexcept {
+		//returns the index of the shared name plus one if the id is one.
+		if (!h.m_shapes || !id)
+			return 0;
+		json_string text = chars(h, id);
+		size_t length = strlen(text);
+		if (length > max_name_length)
+			return 0;
+		uint32_t slot = find_name(h, *h.m_shapes, text, length, hash_key(text, length));
+		return slot && h.m_shapes->names[slot - 1u].id == id ? slot : 0;
+	}
+	inline static void insert_slot(std::vector<uint32_t>& slots, uint32_t hash, uint32_t slot) noexcept {
+		//the high half of the hash is kept beside the index, so most misses never read the entry.
+		uint32_t mask = uint32_t(slots.size() - 1u);
+		uint32_t i = hash & mask;
+		while (slots[i])
+			i = (i + 1u) & mask;
+		slots[i] = (hash & 0xFFFF0000u) | slot;
+	}
+	inline static void fill_name_slots(json_shapes& s) noexcept {
+		std::fill(s.name_slots.begin(), s.name_slots.end(), 0u);
+		for (uint32_t i = 0; i < s.names.size(); ++i)
+			insert_slot(s.name_slots, s.names[i].hash, i + 1u);
+	}
+	inline static void fill_shape_slots(json_shapes& s) noexcept {
+		std::fill(s.shape_slots.begin(), s.shape_slots.end(), 0u);
+		for (uint32_t i = 0; i < s.shapes.size(); ++i)
+			insert_slot(s.shape_slots, uint32_t(s.shapes[i].hash), i + 1u);
+	}
+	inline static bool grow_slots(std::vector<uint32_t>& slots, size_t count) {
+		//keeps the tables at most half full.
+		if (count * 2u <= slots.size())
+			return false;
+		slots.resize(std::max<size_t>(64u, slots.size() * 2u));
+		return true;
+	}
+	inline static json_char* escape_chars(json_string s, json_char* out) noexcept {
+		//matches dump_string_escaped; out must hold escaped_length chars.
+		static constexpr json_char hex[] = "0123456789abcdef";
+		for (; *s; ++s) {
+			uint8_t c = uint8_t(*s);
+			if (escapes[c]) {
+				*out++ = '\\';
+				*out++ = escapes[c];
+			}
+			else if (c < 0x20u) {
+				memcpy(out, "\\u00", 4);
+				out[4] = hex[c >> 4];
+				out[5] = hex[c & 15u];
+				out += 6;
+			}
+			else {
+				*out++ = *s;
 			}
-			if (!dump_char(heap, ']')) return false;
-			return true;
-		}
-		if (type == json_type_null) {
-			return dump_string(heap, "null");
 		}
-		return false;
+		return out;
 	}
-};
-
-nix::json_heap::~json_heap() noexcept {
-	free(m_values + 1);
-	free(m_chars);
-	free(m_dump);
-}
-nix::json_heap::json_heap() noexcept
-	: m_values_capacity(0), m_values_count(0), m_values(((json_value*)(0)) - 1)
-	, m_chars_capacity(0), m_chars_count(0), m_chars(0)
+	inline static bool share_name(json_heap& h, json_node id, uint32_t length, uint32_t hash) noexcept {
+		//the name must hold no backslash, so a later source that matches it needs no decoding.
+		if (!h.m_shapes && !(h.m_shapes = new (std::nothrow) json_shapes()))
+			return false;
+		json_shapes& s = *h.m_shapes;
+		if (s.names.size() >= max_names)
+			return false;
+		try {
+			s.names.push_back({ id, 0, hash, length, 0 });
+			if (grow_slots(s.name_slots, s.names.size()))
+				fill_name_slots(s);
+			else
+				insert_slot(s.name_slots, hash, uint32_t(s.names.size()));
+		}
+		catch (...) {
+			if (s.names.size() && s.names.back().id == id)
+				s.names.pop_back();
+			return false;
+		}
+		s.last = std::max(s.last, id);
+		return true;
+	}
+	inline static bool share_prefix(json_heap& h, json_shapes::name& n) noexcept {
+		if (n.prefix)
+			return true;
+		uint32_t length = uint32_t(escaped_length(chars(h, n.id))) + 3u;
+		json_node prefix = alloc_chars(h, length + 1u);
+		if (!prefix)
+			return false;
+		json_char* out = chars(h, prefix);
+		*out++ = '"';
+		out = escape_chars(chars(h, n.id), out);
+		*out++ = '"';
+		*out++ = ':';
+		*out = '\0';
+		n.prefix = prefix;
+		n.prefix_length = length;
+		h.m_shapes->last = std::max(h.m_shapes->last, prefix);
+		return true;
+	}
+	struct json_failure {
+		json_error_code code;
+		const json_char* at;
+		//the open container when loading stopped.
+		json_node parent;
+		//what the load made, so it can be discarded.
+		json_node root;
+		uint32_t nodes;
+		uint32_t chars;
+		//the objects open at the first depths: the shape they are expected to have, how many names matched it, and whether every name is shared.
+		struct json_open {
+			uint16_t shape;
+			uint16_t index;
+			bool shared;
+		} open[json_shapes::depth];
+		uint32_t depth;
+		//true if new nodes take increasing ids.
+		bool appending;
+	};
+	inline static json_node fail(json_failure& f, json_error_code code, const json_char* at) noexcept {
+		f.code = code;
+		f.at = at;
+		return 0;
+	}
+	inline static json_node store_chars(json_heap& h, const json_char*& s, const json_char* quote, json_failure& f) noexcept {
+		//expects the source at the opening quote. decodes straight into the chars, which are trimmed to the decoded length.
+		if (size_t(quote - s) >= std::numeric_limits<uint32_t>::max())
+			return fail(f, json_error_memory, s);
+		json_node start = alloc_chars(h, uint32_t(quote - s));
+		if (!start)
+			return fail(f, json_error_memory, s);
+		json_char* begin = chars(h, start);
+		json_char* end = decode_chars(s + 1, quote, begin);
+		if (!end)
+			return fail(f, json_error_string, s);
+		*end++ = '\0';
+		h.m_chars_count = start + uint32_t(end - begin);
+		s = quote + 1;
+		return start;
+	}
+	inline static json_node load_chars(json_heap& h, const json_char*& s, const json_char* e, json_failure& f) noexcept {
+		const json_char* quote = scan_string(s + 1, e);
+		if (!quote)
+			return fail(f, memchr(s + 1, '"', size_t(e - s - 1)) ? json_error_string : json_error_end, s);
+		return store_chars(h, s, quote, f);
+	}
+	inline static json_node load_name(json_heap& h, const json_char*& s, const json_char* e, json_failure& f) noexcept {
+		//short names are shared. shared names hold no backslash, so a source that matches one needs no decoding.
+		const json_char* quote = scan_string(s + 1, e);
+		if (!quote)
+			return fail(f, memchr(s + 1, '"', size_t(e - s - 1)) ? json_error_string : json_error_end, s);
+		size_t length = size_t(quote - s - 1);
+		if (f.depth > json_shapes::depth)
+			return store_chars(h, s, quote, f);
+		json_failure::json_open& o = f.open[f.depth - 1u];
+		if (length > max_name_length) {
+			o.shared = false;
+			return store_chars(h, s, quote, f);
+		}
+		//the name at the same place in the expected shape is tried first.
+		if (o.shape) {
+			const json_shapes& shapes = *h.m_shapes;
+			const json_shapes::shape& shape = shapes.shapes[o.shape - 1u];
+			if (o.index < shape.count) {
+				const json_shapes::key& key = shapes.keys[shape.keys + o.index];
+				if (shapes.names[key.name].length == length && memcmp(chars(h, key.id), s + 1, length) == 0) {
+					++o.index;
+					s = quote + 1;
+					return key.id;
+				}
+			}
+			o.shape = 0;
+		}
+		//once no names can be added, they are only looked up for objects that can still have a shape.
+		if (!o.shared && h.m_shapes && h.m_shapes->names.size() >= max_names)
+			return store_chars(h, s, quote, f);
+		uint32_t hash = hash_key(s + 1, length);
+		uint32_t slot = h.m_shapes ? find_name(h, *h.m_shapes, s + 1, length, hash) : 0;
+		if (slot) {
+			s = quote + 1;
+			return h.m_shapes->names[slot - 1u].id;
+		}
+		uint32_t count = h.m_chars_count;
+		json_node name = store_chars(h, s, quote, f);
+		if (!name)
+			return 0;
+		uint32_t decoded = h.m_chars_count - name - 1u;
+		if (decoded != length) {
+			//escaped names are shared by what they decode to.
+			json_string text = chars(h, name);
+			if (memchr(text, '\\', decoded)) {
+				o.shared = false;
+				return name;
+			}
+			hash = hash_key(text, decoded);
+			slot = h.m_shapes ? find_name(h, *h.m_shapes, text, decoded, hash) : 0;
+			if (slot) {
+				h.m_chars_count = count;
+				return h.m_shapes->names[slot - 1u].id;
+			}
+		}
+		if (!share_name(h, name, decoded, hash))
+			o.shared = false;
+		return name;
+	}
+	inline static json_node load_key(json_heap& h, const json_char*& s, const json_char* e, json_failure& f) noexcept {
+		//leaves the source at the member's value.
+		if (s == e || *s != '"')
+			return fail(f, s == e ? json_error_end : json_error_syntax, s);
+		json_node name = load_name(h, s, e, f);
+		if (!name)
+			return 0;
+		s = skip_whitespace(s, e);
+		if (s == e || *s != ':')
+			return fail(f, s == e ? json_error_end : json_error_syntax, s);
+		s = skip_whitespace(s + 1, e);
+		return name;
+	}
+	inline static uint64_t hash_shape(uint64_t hash, json_node name) noexcept {
+		//shapes are hashed by the ids of their names, and finished with mix(hash ^ count).
+		return (hash ^ name) * 0x9e3779b97f4a7c15ull;
+	}
+	inline static void rehash_shapes(json_shapes& s) noexcept {
+		for (json_shapes::shape& shape : s.shapes) {
+			uint64_t hash = 0;
+			for (uint32_t i = 0; i < shape.count; ++i)
+				hash = hash_shape(hash, s.keys[shape.keys + i].id);
+			shape.hash = mix(hash ^ shape.count);
+		}
+		fill_shape_slots(s);
+	}
+	inline static uint32_t find_shape(const json_shapes& s, const json_node* names, uint32_t count, uint64_t hash) noexcept {
+		if (s.shape_slots.empty())
+			return 0;
+		uint32_t mask = uint32_t(s.shape_slots.size() - 1u);
+		for (uint32_t i = uint32_t(hash) & mask;; i = (i + 1u) & mask) {
+			uint32_t slot = s.shape_slots[i];
+			if (!slot)
+				return 0;
+			if ((slot ^ uint32_t(hash)) >> 16)
+				continue;
+			slot &= 0xFFFFu;
+			const json_shapes::shape& shape = s.shapes[slot - 1u];
+			if (shape.hash != hash || shape.count != count)
+				continue;
+			uint32_t key = 0;
+			while (key < count && s.keys[shape.keys + key].id == names[key])
+				++key;
+			if (key == count)
+				return slot;
+		}
+	}
+	inline static uint32_t add_shape(json_heap& h, json_shapes& s, const json_node* names, uint32_t count, uint64_t hash) noexcept {
+		if (s.shapes.size() >= max_shapes)
+			return 0;
+		size_t keys = s.keys.size();
+		try {
+			for (uint32_t i = 0; i < count; ++i) {
+				uint32_t slot = shared_name(h, names[i]);
+				if (!slot || !share_prefix(h, s.names[slot - 1u])) {
+					s.keys.resize(keys);
+					return 0;
+				}
+				s.keys.push_back({ names[i], slot - 1u });
+			}
+			s.shapes.push_back({ hash, uint32_t(keys), count });
+			if (grow_slots(s.shape_slots, s.shapes.size()))
+				fill_shape_slots(s);
+			else
+				insert_slot(s.shape_slots, uint32_t(hash), uint32_t(s.shapes.size()));
+		}
+		catch (...) {
+			if (s.shapes.size() && s.shapes.back().keys == keys)
+				s.shapes.pop_back();
+			s.keys.resize(keys);
+			return 0;
+		}
+		return uint32_t(s.shapes.size());
+	}
+	inline static void close_shape(json_heap& h, json_node object, const json_failure& f) noexcept {
+		//expects a loaded object whose names are all shared. members with consecutive ids are marked dense so they can be indexed.
+		const json_failure::json_open& o = f.open[f.depth];
+		json_shapes& s = *h.m_shapes;
+		json_node first = value(h, object).object_or_array.first;
+		uint32_t shape = 0;
+		bool dense = true;
+		if (o.shape && o.index == s.shapes[o.shape - 1u].count) {
+			//every name matched the expected shape.
+			shape = o.shape;
+			if (f.appending)
+				dense = value(h, object).object_or_array.last - first == o.index - 1u;
+			else
+				for (json_node curr = first, i = 0; curr && dense; curr = value(h, curr).next, ++i)
+					dense = curr == first + i;
+		}
+		else {
+			json_node names[max_shape_keys];
+			uint32_t count = 0;
+			uint64_t hash = 0;
+			json_node curr = first;
+			for (; curr && count < max_shape_keys; curr = value(h, curr).next) {
+				dense = dense && curr == first + count;
+				names[count] = value(h, curr).name;
+				hash = hash_shape(hash, names[count++]);
+			}
+			hash = mix(hash ^ count);
+			if (!curr && !(shape = find_shape(s, names, count, hash)))
+				shape = add_shape(h, s, names, count, hash);
+		}
+		value(h, object).shape = shape ? uint16_t(shape | (dense ? shape_dense : 0u)) : 0;
+		s.recent[f.depth] = uint16_t(shape);
+	}
+	inline static json_node find_member(const json_heap& h, json_node object, json_string name) noexcept {
+		//a shaped object's names are compared without visiting its members. the member is indexed when its ids are consecutive.
+		const json_value& o = value(h, object);
+		const json_shapes& s = *h.m_shapes;
+		const json_shapes::shape& shape = s.shapes[(o.shape & ~shape_dense) - 1u];
+		size_t length = strlen(name);
+		for (uint32_t i = 0; i < shape.count; ++i) {
+			const json_shapes::name& n = s.names[s.keys[shape.keys + i].name];
+			if (n.length != length || memcmp(chars(h, n.id), name, length) != 0)
+				continue;
+			if (o.shape & shape_dense)
+				return o.object_or_array.first + i;
+			json_node child = o.object_or_array.first;
+			while (i--)
+				child = value(h, child).next;
+			return child;
+		}
+		return 0;
+	}
+	inline static json_node load(json_heap& h, const json_char*& source, const json_char* e, json_failure& f) noexcept {
+		//one loop for every format. the open container is found again through the parent links, so nesting needs no stack.
+		//leaves the source after the value; what follows is not checked.
+		const json_char* s = skip_whitespace(source, e);
+		json_node& root = f.root;
+		json_node& parent = f.parent;
+		json_node name = 0;
+		root = 0;
+		parent = 0;
+		f.nodes = h.m_values_count;
+		f.chars = h.m_chars_count;
+		f.depth = 0;
+		f.appending = !h.m_free || h.m_marks;
+		while (true) {
+			if (s == e)
+				return fail(f, json_error_end, s);
+			json_char c = *s;
+			json_node node = parent ? alloc_node(h, parent, name) : alloc_node(h);
+			if (!node)
+				return fail(f, json_error_memory, s);
+			if (!root)
+				root = node;
+			if (c == '{' || c == '[') {
+				json_value& v = value(h, node);
+				v.type = c == '{' ? json_type_object : json_type_array;
+				v.object_or_array.first = 0;
+				v.object_or_array.last = 0;
+				s = skip_whitespace(s + 1, e);
+				if (s < e && *s == (c == '{' ? '}' : ']')) {
+					++s;
+				}
+				else {
+					parent = node;
+					name = 0;
+					if (f.depth < json_shapes::depth)
+						f.open[f.depth] = { c == '{' && h.m_shapes ? h.m_shapes->recent[f.depth] : uint16_t(0), 0, c == '{' };
+					++f.depth;
+					if (c == '{' && !(name = load_key(h, s, e, f)))
+						return 0;
+					continue;
+				}
+			}
+			else if (c == '"') {
+				json_node chars = load_chars(h, s, e, f);
+				value(h, node).type = json_type_string;
+				if (!chars) {
+					value(h, node).type = json_type_null;
+					return 0;
+				}
+				value(h, node).string.value = chars;
+			}
+			else if (c == 't' || c == 'f' || c == 'n') {
+				const json_char* end = scan_literal(s, e);
+				json_value& v = value(h, node);
+				if (!end) {
+					v.type = json_type_null;
+					return fail(f, json_error_syntax, s);
+				}
+				v.type = c == 'n' ? json_type_null : json_type_boolean;
+				v.boolean.value = c == 't';
+				s = end;
+			}
+			else {
+				const json_char* end = scan_number(s, e);
+				value(h, node).type = json_type_number;
+				if (!end) {
+					value(h, node).type = json_type_null;
+					return fail(f, c == '-' || (c >= '0' && c <= '9') ? json_error_number : json_error_syntax, s);
+				}
+				value(h, node).number.value = scan_double(s, end);
+				s = end;
+			}
+			//closes containers until a comma opens the next value.
+			while (true) {
+				if (!parent) {
+					source = s;
+					f.at = s;
+					return root;
+				}
+				s = skip_whitespace(s, e);
+				if (s == e)
+					return fail(f, json_error_end, s);
+				bool object = value(h, parent).type == json_type_object;
+				if (*s == ',') {
+					s = skip_whitespace(s + 1, e);
+					name = 0;
+					if (object && !(name = load_key(h, s, e, f)))
+						return 0;
+					break;
+				}
+				if (*s != (object ? '}' : ']'))
+					return fail(f, json_error_syntax, s);
+				++s;
+				if (--f.depth < json_shapes::depth && f.open[f.depth].shared)
+					close_shape(h, parent, f);
+				parent = value(h, parent).parent;
+			}
+		}
+	}
+	inline static void drop(json_heap& h, json_node stop, uint32_t nodes, uint32_t chars) noexcept {
+		//forgets every node above the count. they are unlinked from the free list, which is walked until stop.
+		json_node* link = &h.m_free;
+		while (*link != stop) {
+			if (*link > nodes)
+				*link = value(h, *link).next;
+			else
+				link = &value(h, *link).next;
+		}
+		for (json_node node = nodes + 1u; node <= h.m_values_count && node < h.m_hashes_capacity; ++node)
+			h.m_hashes[node] = 0;
+		h.m_values_count = nodes;
+		h.m_chars_count = chars;
+		drop_shapes(h, chars);
+	}
+	inline static void rollback(json_heap& h, uint32_t nodes, uint32_t chars) noexcept {
+		//new nodes under older containers are unlinked. each container's children are filtered once; the unlinked ones lose their parent so it is not visited again.
+		for (json_node node = nodes + 1u; node <= h.m_values_count; ++node) {
+			json_value& v = value(h, node);
+			if (v.type == json_type_invalid || !v.parent || v.parent > nodes)
+				continue;
+			json_node parent = v.parent;
+			invalidate(h, parent);
+			json_value& p = value(h, parent);
+			json_node prev = 0;
+			for (json_node curr = p.object_or_array.first; curr;) {
+				json_node next = value(h, curr).next;
+				if (curr > nodes) {
+					value(h, curr).parent = 0;
+					if (prev)
+						value(h, prev).next = next;
+					else
+						p.object_or_array.first = next;
+				}
+				else {
+					prev = curr;
+				}
+				curr = next;
+			}
+			p.object_or_array.last = prev;
+		}
+		drop(h, 0, nodes, chars);
+	}
+	inline static void discard(json_heap& h, const json_failure& f) noexcept {
+		//a load makes its nodes in preorder and takes ids from the head of the free list first.
+		//walking the same order finds the taken ids in the order they were taken, so the free list is put back as it was. the rest are dropped.
+		if (f.root) {
+			json_node taken = 0;
+			json_node* link = &taken;
+			json_node curr = f.root;
+			while (curr) {
+				json_value& v = value(h, curr);
+				if (curr <= f.nodes) {
+					//names are not needed by the walk, so they chain the taken ids.
+					*link = curr;
+					link = &v.name;
+				}
+				json_node next = is_container(v) ? v.object_or_array.first : 0;
+				while (!next && curr != f.root) {
+					next = value(h, curr).next;
+					if (!next)
+						curr = value(h, curr).parent;
+				}
+				curr = next;
+			}
+			*link = 0;
+			json_node node = taken;
+			while (node) {
+				json_value& v = value(h, node);
+				json_node next = v.name;
+				if (node < h.m_hashes_capacity)
+					h.m_hashes[node] = 0;
+				v.type = json_type_invalid;
+				v.lazy = false;
+				v.parent = 0;
+				v.name = 0;
+				v.next = next ? next : h.m_free;
+				node = next;
+			}
+			if (taken)
+				h.m_free = taken;
+		}
+		drop(h, h.m_free, f.nodes, f.chars);
+	}
+	inline static json_node load_text(json_heap& h, const json_char* source, size_t length, json_format format, json_failure& f) noexcept {
+		f.parent = 0;
+		f.root = 0;
+		f.nodes = h.m_values_count;
+		f.chars = h.m_chars_count;
+		f.depth = 0;
+		if (h.m_strict) {
+			size_t valid = utf8_length(source, length);
+			if (valid != length)
+				return fail(f, json_error_utf8, source + valid);
+		}
+		if (format != json_format_pretty && format != json_format_dense)
+			return fail(f, json_error_syntax, source);
+		return load(h, source, source + length, f);
+	}
+	inline static void escape_token(std::string& out, const json_char* name) {
+		for (; *name; ++name) {
+			if (*name == '~')
+				out += "~0";
+			else if (*name == '/')
+				out += "~1";
+			else
+				out += *name;
+		}
+	}
+	inline static void report(const json_heap& h, const json_char* begin, const json_failure& f, json_error& error) noexcept {
+		//only runs once loading has failed, so nothing here is on the fast path.
+		error.code = f.code;
+		error.offset = size_t(f.at - begin);
+		error.line = 1u;
+		const json_char* line = begin;
+		for (const json_char* c = begin; c < f.at; ++c) {
+			if (*c == '\n') {
+				++error.line;
+				line = c + 1;
+			}
+		}
+		error.column = uint64_t(f.at - line) + 1u;
+		error.path.clear();
+		try {
+			//the path ends at the last value started in the open container.
+			json_node node = f.parent;
+			if (node && value(h, node).object_or_array.last)
+				node = value(h, node).object_or_array.last;
+			std::vector<std::string> tokens;
+			while (node && value(h, node).parent) {
+				json_node parent = value(h, node).parent;
+				std::string token;
+				if (value(h, parent).type == json_type_object) {
+					escape_token(token, chars(h, value(h, node).name));
+				}
+				else {
+					uint64_t index = 0;
+					for (json_node child = value(h, parent).object_or_array.first; child && child != node; child = value(h, child).next)
+						++index;
+					token = std::to_string(index);
+				}
+				tokens.push_back(std::move(token));
+				node = parent;
+			}
+			for (size_t i = tokens.size(); i--;) {
+				error.path += '/';
+				error.path += tokens[i];
+			}
+		}
+		catch (...) {
+			error.path.clear();
+		}
+	}
+
+	inline static bool is_whitespace(json_char character) noexcept {
+		return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+	}
+	inline static bool do_whitespace(json_string& source) noexcept {
+		size_t s = 0;
+		while (source[s] && is_whitespace(source[s])) ++s;
+		source += s;
+		return *source;
+	}
+
+	inline static json_string skip_string(json_string s) noexcept {
+		//expects the source after the opening quote. returns the source after the closing quote.
+		while (true) {
+			s = strpbrk(s, "\"\\");
+			if (!s)
+				return 0;
+			if (*s++ == '"')
+				return s;
+			if (!*s++)
+				return 0;
+		}
+	}
+	inline static json_string skip_container(json_string s) noexcept {
+		//bracket matching only; the structure is checked when the container is resolved.
+		size_t depth = 0;
+		while (true) {
+			s = strpbrk(s, "\"{}[]");
+			if (!s)
+				return 0;
+			json_char c = *s++;
+			if (c == '"') {
+				if (!(s = skip_string(s)))
+					return 0;
+			}
+			else if (c == '{' || c == '[') {
+				++depth;
+			}
+			else if (--depth == 0) {
+				return s;
+			}
+		}
+	}
+	inline static json_node decode_string(json_heap& h, json_string& s) noexcept {
+		//decodes straight into the chars because the dump may be in use by save_string.
+		json_string end = skip_string(s);
+		if (!end || size_t(end - s) >= std::numeric_limits<uint32_t>::max())
+			return 0;
+		json_node start = alloc_chars(h, uint32_t(end - s), true);
+		if (!start)
+			return 0;
+		json_char* begin = chars(h, start);
+		json_char* out = begin;
+		for (--end; s < end;) {
+			if (*s == '\\') {
+				uint32_t length = decode_escape(++s, out);
+				if (!length)
+					return 0;
+				out += length;
+			}
+			else {
+				*out++ = *s++;
+			}
+		}
+		*out++ = '\0';
+		h.m_chars_count = start + uint32_t(out - begin);
+		s = end + 1;
+		return start;
+	}
+	inline static json_node alloc_lazy(json_heap& h, json_node parent, json_node name, json_string& s) noexcept {
+		json_type type;
+		json_string source = s;
+		if (strncmp(s, "true", 4) == 0 || strncmp(s, "null", 4) == 0) {
+			type = *s == 't' ? json_type_boolean : json_type_null;
+			s += 4;
+		}
+		else if (strncmp(s, "false", 5) == 0) {
+			type = json_type_boolean;
+			s += 5;
+		}
+		else if (*s == '"') {
+			type = json_type_string;
+			s = skip_string(s + 1);
+		}
+		else if (*s == '{' || *s == '[') {
+			type = *s == '{' ? json_type_object : json_type_array;
+			s = skip_container(s);
+		}
+		else {
+			//malformed numbers like +1 or 01 are skipped and read as null, like other malformed values.
+			size_t length = strspn(s, "+-.0123456789eE");
+			type = scan_number(s, s + length) == s + length ? json_type_number : json_type_null;
+			s = length ? s + length : 0;
+		}
+		if (!s)
+			return 0;
+		json_node node = parent ? alloc_node(h, parent, name) : alloc_node(h);
+		if (!node)
+			return 0;
+		json_value& v = value(h, node);
+		v.type = type;
+		if (type == json_type_boolean) {
+			v.boolean.value = *source == 't';
+		}
+		else if (type != json_type_null) {
+			v.source.value = source;
+			v.lazy = true;
+		}
+		return node;
+	}
+	inline static void resolve_object(json_heap& h, json_node node, json_string s) noexcept {
+		if (!do_whitespace(++s) || *s == '}')
+			return;
+		while (*s++ == '"') {
+			json_node name = decode_string(h, s);
+			if (!name || !do_whitespace(s) || *s++ != ':' || !do_whitespace(s))
+				return;
+			if (!alloc_lazy(h, node, name, s) || !do_whitespace(s))
+				return;
+			if (*s++ != ',' || !do_whitespace(s))
+				return;
+		}
+	}
+	inline static void resolve_array(json_heap& h, json_node node, json_string s) noexcept {
+		if (!do_whitespace(++s) || *s == ']')
+			return;
+		while (alloc_lazy(h, node, 0, s) && do_whitespace(s)) {
+			if (*s++ != ',' || !do_whitespace(s))
+				return;
+		}
+	}
+	inline static bool resolve_lazy(json_heap& h, json_node node) noexcept {
+		json_value& v = value(h, node);
+		json_string s = v.source.value;
+		v.lazy = false;
+		if (v.type == json_type_number) {
+			char* end;
+			v.number.value = strtod(s, &end);
+			if (end != s)
+				return true;
+		}
+		else if (v.type == json_type_string) {
+			json_node string = decode_string(h, ++s);
+			if (string) {
+				value(h, node).string.value = string;
+				return true;
+			}
+		}
+		else if (v.type == json_type_object) {
+			v.object_or_array = {};
+			resolve_object(h, node, s);
+			return true;
+		}
+		else if (v.type == json_type_array) {
+			v.object_or_array = {};
+			resolve_array(h, node, s);
+			return true;
+		}
+		value(h, node).type = json_type_null;
+		return false;
+	}
+	inline static bool resolve(const json_heap& h, json_node node) noexcept {
+		//lazy nodes are decoded on first access, even through const accessors.
+		return !value(h, node).lazy || resolve_lazy(const_cast<json_heap&>(h), node);
+	}
+	inline static void resolve_subtree(const json_heap& h, json_node node) noexcept {
+		json_node curr = node;
+		while (true) {
+			resolve(h, curr);
+			const json_value& v = value(h, curr);
+			json_node next = (v.type == json_type_object || v.type == json_type_array) ? v.object_or_array.first : 0;
+			while (!next) {
+				if (curr == node)
+					return;
+				next = value(h, curr).next;
+				if (next)
+					break;
+				curr = value(h, curr).parent;
+			}
+			curr = next;
+		}
+	}
+
+	struct json_counts {
+		uint64_t counts[7];
+	};
+	inline static void scan_add(json_number_stats& s, const json_value& v) noexcept {
+		//branchless apart from lazy numbers, which are parsed from their source without resolving them. their source was checked by scan_number when the node was made.
+		bool number = v.type == json_type_number;
+		if (number && v.lazy) {
+			json_number n = strtod(v.source.value, 0);
+			s.sum += n;
+			s.min = std::min(s.min, n);
+			s.max = std::max(s.max, n);
+			++s.count;
+			return;
+		}
+		json_number n = v.number.value;
+		s.sum += number ? n : 0.0;
+		s.min = number && n < s.min ? n : s.min;
+		s.max = number && n > s.max ? n : s.max;
+		s.count += number;
+	}
+	inline static void scan_add(json_counts& c, const json_value& v) noexcept {
+		++c.counts[v.type];
+	}
+	inline static void scan_merge(json_number_stats& a, const json_number_stats& b) noexcept {
+		a.count += b.count;
+		a.sum += b.sum;
+		a.min = std::min(a.min, b.min);
+		a.max = std::max(a.max, b.max);
+	}
+	inline static void scan_merge(json_counts& a, const json_counts& b) noexcept {
+		for (uint32_t i = 0; i < 7u; ++i)
+			a.counts[i] += b.counts[i];
+	}
+	template<typename S>
+	inline static void scan_range(const json_heap& h, json_node first, json_node last, S& s) noexcept {
+		//one chunk at a time, so the inner loop only strides through values.
+		uint64_t node = first;
+		while (node && node <= last) {
+			uint64_t end = std::min<uint64_t>(uint64_t(last) + 1u, (node | chunk_mask(h.m_values_shift)) + 1u);
+			const json_value* v = &value(h, json_node(node));
+			for (uint64_t i = 0, count = end - node; i < count; ++i)
+				scan_add(s, v[i]);
+			node = end;
+		}
+	}
+	template<bool resolving, typename S>
+	inline static void scan_subtree(const json_heap& h, json_node node, S& s) noexcept {
+		//preorder through the links. threads expect a resolved subtree; malformed lazy nodes are stepped over.
+		json_node curr = node;
+		while (true) {
+			if (resolving)
+				resolve(h, curr);
+			const json_value& v = value(h, curr);
+			scan_add(s, v);
+			json_node next = is_container(v) ? v.object_or_array.first : 0;
+			while (!next) {
+				if (curr == node)
+					return;
+				next = value(h, curr).next;
+				if (next)
+					break;
+				curr = value(h, curr).parent;
+			}
+			curr = next;
+		}
+	}
+	template<typename S>
+	struct json_scan {
+		const json_heap* heap;
+		//split subtrees, or none to split the whole node table.
+		const json_node* children;
+		uint32_t children_count;
+		uint32_t count;
+		S* results;
+		static void run(void* context, uint32_t index) {
+			const json_scan& t = *(const json_scan*)context;
+			if (!t.children) {
+				json_node first, last;
+				t.heap->get_parallel_range(index, t.count, first, last);
+				scan_range(*t.heap, first, last, t.results[index]);
+				return;
+			}
+			uint32_t first = uint32_t(uint64_t(t.children_count) * index / t.count);
+			uint32_t last = uint32_t(uint64_t(t.children_count) * (index + 1u) / t.count);
+			for (uint32_t i = first; i < last; ++i)
+				scan_subtree<false>(*t.heap, t.children[i], t.results[index]);
+		}
+	};
+	template<typename S>
+	inline static void scan(const json_heap& h, json_node node, uint32_t threads, S& result) noexcept {
+		//the whole table is split into id ranges. a subtree is split between its children, but only when it looks large;
+		//a freshly loaded subtree spans the ids up to its last descendant, which is cheap to find.
+		std::vector<json_node> children;
+		uint32_t count = 1;
+		if (!node) {
+			count = h.get_parallel_ranges(threads);
+		}
+		else {
+			if (h.is_invalid(node))
+				return;
+			json_node last = node;
+			while (is_container(value(h, last)) && value(h, last).object_or_array.last)
+				last = value(h, last).object_or_array.last;
+			uint32_t ranges = std::min(h.get_parallel_ranges(threads), last > node ? (last - node) / 65536u : 0u);
+			if (ranges > 1u) {
+				try {
+					for (json_node child = value(h, node).object_or_array.first; child; child = value(h, child).next)
+						children.push_back(child);
+				}
+				catch (...) {
+					children.clear();
+				}
+				count = std::min<uint32_t>(ranges, uint32_t(children.size()));
+			}
+			if (count <= 1u) {
+				scan_subtree<true>(h, node, result);
+				return;
+			}
+			resolve_subtree(h, node);
+			scan_add(result, value(h, node));
+		}
+		std::vector<S> results;
+		try {
+			results.resize(count, S());
+		}
+		catch (...) {
+			//no room to split the work, so it runs on this thread.
+			if (node)
+				for (json_node child : children)
+					scan_subtree<false>(h, child, result);
+			else
+				scan_range(h, 1u, h.m_values_count, result);
+			return;
+		}
+		json_scan<S> t = { &h, node ? children.data() : 0, uint32_t(children.size()), count, results.data() };
+		run_parallel(count, &json_scan<S>::run, &t);
+		for (const S& s : results)
+			scan_merge(result, s);
+	}
+
+	struct json_shape_slot {
+		//an id, since resolving lazy rows can move the chars.
+		json_node name;
+		//the column of the member, or the column count if the member is not extracted.
+		uint32_t column;
+	};
+	struct json_extract {
+		static constexpr uint32_t shape_count = 4u;
+		const json_heap& heap;
+		const json_string* names;
+		uint32_t count;
+		json_column* columns;
+		//the row each column was last written in, so a duplicate member does not overwrite the first.
+		std::vector<uint32_t> written;
+		//recently seen member orders, most recent first.
+		std::vector<json_shape_slot> shapes[shape_count];
+		std::vector<json_shape_slot> shape;
+	};
+	inline static void column_null(json_column& c, uint32_t row) {
+		if (c.nulls.size() <= (row >> 6))
+			c.nulls.resize((row >> 6) + 1u, 0u);
+		c.nulls[row >> 6] |= uint64_t(1) << (row & 63u);
+	}
+	inline static void column_write(json_extract& x, uint32_t column, uint32_t row, json_node node) {
+		if (column >= x.count || x.written[column] == row + 1u)
+			return;
+		x.written[column] = row + 1u;
+		json_column& c = x.columns[column];
+		resolve(x.heap, node);
+		const json_value& v = value(x.heap, node);
+		if (v.lazy) {
+			column_null(c, row);
+			return;
+		}
+		c.types[row] = v.type;
+		if (v.type == json_type_number) {
+			if (c.numbers.size() <= row)
+				c.numbers.resize(size_t(row) + 1u, 0.0);
+			c.numbers[row] = v.number.value;
+		}
+		else if (v.type == json_type_boolean) {
+			if (c.booleans.size() <= row)
+				c.booleans.resize(size_t(row) + 1u, 0u);
+			c.booleans[row] = v.boolean.value ? 1u : 0u;
+		}
+		else if (v.type == json_type_string) {
+			//rows without a string get empty runs when the next string or the end fills their offsets.
+			while (c.offsets.size() <= row)
+				c.offsets.push_back(uint32_t(c.chars.size()));
+			json_string string = chars(x.heap, v.string.value);
+			c.chars.insert(c.chars.end(), string, string + strlen(string));
+			if (c.chars.size() > std::numeric_limits<uint32_t>::max())
+				throw std::bad_alloc();
+		}
+		else {
+			column_null(c, row);
+		}
+	}
+	inline static uint32_t column_find(const json_extract& x, json_string name) noexcept {
+		for (uint32_t i = 0; i < x.count; ++i)
+			if (strcmp(x.names[i], name) == 0)
+				return i;
+		return x.count;
+	}
+	inline static void extract_row(json_extract& x, json_node row_node, uint32_t row) {
+		//members are matched against the recent shapes by position, so a row laid out like an earlier one needs one compare per member.
+		//a row that matches none is looked up by name and becomes the most recent shape.
+		json_node first = value(x.heap, row_node).object_or_array.first;
+		if (!first)
+			return;
+		uint32_t hit = json_extract::shape_count;
+		for (uint32_t s = 0; s < json_extract::shape_count && hit == json_extract::shape_count; ++s) {
+			const std::vector<json_shape_slot>& shape = x.shapes[s];
+			if (shape.empty())
+				break;
+			size_t i = 0;
+			json_node member = first;
+			for (; member && i < shape.size(); member = value(x.heap, member).next, ++i) {
+				json_node name = value(x.heap, member).name;
+				if (name != shape[i].name && strcmp(chars(x.heap, name), chars(x.heap, shape[i].name)) != 0)
+					break;
+			}
+			if (!member && i == shape.size())
+				hit = s;
+		}
+		if (hit == json_extract::shape_count) {
+			x.shape.clear();
+			for (json_node member = first; member; member = value(x.heap, member).next) {
+				json_node name = value(x.heap, member).name;
+				x.shape.push_back({ name, column_find(x, chars(x.heap, name)) });
+			}
+			hit = json_extract::shape_count - 1u;
+			x.shapes[hit].swap(x.shape);
+		}
+		//the matched shape moves to the front.
+		for (uint32_t s = hit; s > 0; --s)
+			x.shapes[s].swap(x.shapes[s - 1u]);
+		const std::vector<json_shape_slot>& shape = x.shapes[0];
+		size_t i = 0;
+		for (json_node member = first; member; member = value(x.heap, member).next, ++i)
+			column_write(x, shape[i].column, row, member);
+	}
+	inline static uint32_t extract_columns(const json_heap& h, json_node array, const json_string* names, uint32_t count, json_column* columns) {
+		json_extract x = { h, names, count, columns, std::vector<uint32_t>(count, 0u), {}, {} };
+		for (uint32_t i = 0; i < count; ++i)
+			columns[i] = json_column();
+		uint32_t row = 0;
+		for (json_node node = h.get_first(array); node; node = value(h, node).next, ++row) {
+			if (row == std::numeric_limits<uint32_t>::max())
+				throw std::bad_alloc();
+			for (uint32_t i = 0; i < count; ++i)
+				columns[i].types.push_back(json_type_null);
+			if (h.is_object(node) && resolve(h, node))
+				extract_row(x, node, row);
+			for (uint32_t i = 0; i < count; ++i)
+				if (x.written[i] != row + 1u)
+					column_null(columns[i], row);
+		}
+		//every filled buffer is padded to the row count.
+		for (uint32_t i = 0; i < count; ++i) {
+			json_column& c = columns[i];
+			if (!c.numbers.empty())
+				c.numbers.resize(row, 0.0);
+			if (!c.booleans.empty())
+				c.booleans.resize(row, 0u);
+			if (!c.offsets.empty())
+				while (c.offsets.size() <= row)
+					c.offsets.push_back(uint32_t(c.chars.size()));
+			c.nulls.resize((size_t(row) + 63u) >> 6, 0u);
+		}
+		return row;
+	}
+
+	inline static uint64_t mix(uint64_t x) noexcept {
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+	inline static uint64_t hash_chars(json_string s) noexcept {
+		uint64_t x = 0xcbf29ce484222325ull;
+		for (; *s; ++s)
+			x = (x ^ uint8_t(*s)) * 0x100000001b3ull;
+		return x;
+	}
+	inline static uint64_t hash_value(const json_heap& h, json_node node, const uint64_t* hashes) noexcept {
+		//arrays combine their children in order and objects sum them so member order does not matter. children are read from the table, or hashed recursively without one.
+		const json_value& v = value(h, node);
+		uint64_t x = mix(uint64_t(v.type) + 0x9e3779b97f4a7c15ull);
+		if (v.type == json_type_boolean)
+			x = mix(x ^ uint64_t(v.boolean.value));
+		else if (v.type == json_type_number) {
+			json_number n = v.number.value == 0.0 ? 0.0 : v.number.value;
+			uint64_t bits;
+			memcpy(&bits, &n, sizeof(bits));
+			x = mix(x ^ bits);
+		}
+		else if (v.type == json_type_string)
+			x = mix(x ^ hash_chars(chars(h, v.string.value)));
+		else if (v.type == json_type_array) {
+			for (json_node child = v.object_or_array.first; child; child = value(h, child).next)
+				x = mix(x ^ (hashes ? hashes[child] : hash_value(h, child, 0)));
+		}
+		else if (v.type == json_type_object) {
+			uint64_t sum = 0;
+			for (json_node child = v.object_or_array.first; child; child = value(h, child).next)
+				sum += mix(hash_chars(value(h, child).name ? chars(h, value(h, child).name) : "") ^ (hashes ? hashes[child] : hash_value(h, child, 0)));
+			x = mix(x ^ sum);
+		}
+		//zero marks an empty slot in the hash cache.
+		return x ? x : 1u;
+	}
+	inline static uint64_t hash_subtree(const json_heap& h, json_node node, uint64_t* hashes) noexcept {
+		//fills the hash of every node in the subtree, children before parents. lazy nodes must be resolved first.
+		json_node curr = node;
+		while (true) {
+			const json_value& v = value(h, curr);
+			if ((v.type == json_type_object || v.type == json_type_array) && v.object_or_array.first) {
+				curr = v.object_or_array.first;
+				continue;
+			}
+			while (true) {
+				hashes[curr] = hash_value(h, curr, hashes);
+				if (curr == node)
+					return hashes[node];
+				if (value(h, curr).next) {
+					curr = value(h, curr).next;
+					break;
+				}
+				curr = value(h, curr).parent;
+			}
+		}
+	}
+	inline static void invalidate(json_heap& h, json_node node) noexcept {
+		//a changed object no longer matches its shape. a cached hash implies cached descendants, so clearing stops at the first ancestor without one.
+		if (node)
+			value(h, node).shape = 0;
+		for (; node < h.m_hashes_capacity && h.m_hashes[node]; node = value(h, node).parent)
+			h.m_hashes[node] = 0;
+	}
+	inline static void clear_hashes(json_heap& h) noexcept {
+		if (h.m_hashes)
+			memset(h.m_hashes, 0, h.m_hashes_capacity * sizeof(uint64_t));
+	}
+	inline static void drop_shapes(json_heap& h, uint32_t chars) noexcept {
+		//forgets the names and prefixes above the count, and the shapes that use them. names are in the order their chars were made, so they are popped from the back.
+		json_shapes* s = h.m_shapes;
+		if (!s || s->last < chars)
+			return;
+		while (!s->names.empty() && s->names.back().id >= chars)
+			s->names.pop_back();
+		s->last = 0;
+		for (json_shapes::name& n : s->names) {
+			if (n.prefix >= chars)
+				n.prefix = 0;
+			s->last = std::max(s->last, std::max(n.id, n.prefix));
+		}
+		//a shape made after the count is dropped with every later one; only dropped objects use them.
+		size_t kept = 0;
+		for (; kept < s->shapes.size(); ++kept) {
+			const json_shapes::shape& shape = s->shapes[kept];
+			uint32_t key = 0;
+			while (key < shape.count && s->keys[shape.keys + key].name < s->names.size() && s->names[s->keys[shape.keys + key].name].prefix)
+				++key;
+			if (key != shape.count)
+				break;
+		}
+		if (kept < s->shapes.size()) {
+			s->keys.resize(s->shapes[kept].keys);
+			s->shapes.resize(kept);
+		}
+		for (uint16_t& recent : s->recent)
+			if (recent > kept)
+				recent = 0;
+		fill_name_slots(*s);
+		fill_shape_slots(*s);
+	}
+	inline static void clear_shapes(json_heap& h) noexcept {
+		if (h.m_shapes)
+			drop_shapes(h, 0);
+	}
+	inline static bool copy_shapes(json_heap& h, const json_heap& source) noexcept {
+		if (!source.m_shapes) {
+			clear_shapes(h);
+			return true;
+		}
+		if (!h.m_shapes && !(h.m_shapes = new (std::nothrow) json_shapes()))
+			return false;
+		try {
+			*h.m_shapes = *source.m_shapes;
+		}
+		catch (...) {
+			clear_shapes(h);
+			return false;
+		}
+		return true;
+	}
+	inline static void free_hashes(json_heap& h) noexcept {
+		free(h.m_hashes);
+		h.m_hashes = 0;
+		h.m_hashes_capacity = 0;
+	}
+	inline static uint64_t hash_cached(json_heap& h, json_node node) noexcept {
+		//like hash_subtree, but subtrees with a cached hash are not visited again. lazy nodes must be resolved first.
+		if (h.m_hashes_capacity <= h.m_values_count) {
+			uint32_t capacity = std::max(h.m_values_count + 1u, h.m_hashes_capacity * 2u);
+			uint64_t* hashes = (uint64_t*)realloc(h.m_hashes, capacity * sizeof(uint64_t));
+			if (!hashes)
+				return 0;
+			memset(hashes + h.m_hashes_capacity, 0, (capacity - h.m_hashes_capacity) * sizeof(uint64_t));
+			h.m_hashes = hashes;
+			h.m_hashes_capacity = capacity;
+		}
+		uint64_t* hashes = h.m_hashes;
+		if (hashes[node])
+			return hashes[node];
+		json_node curr = node;
+		while (true) {
+			const json_value& v = value(h, curr);
+			json_node child = (v.type == json_type_object || v.type == json_type_array) ? v.object_or_array.first : 0;
+			while (child && hashes[child])
+				child = value(h, child).next;
+			if (child) {
+				curr = child;
+				continue;
+			}
+			while (true) {
+				hashes[curr] = hash_value(h, curr, hashes);
+				if (curr == node)
+					return hashes[node];
+				json_node next = value(h, curr).next;
+				while (next && hashes[next])
+					next = value(h, next).next;
+				if (next) {
+					curr = next;
+					break;
+				}
+				curr = value(h, curr).parent;
+			}
+		}
+	}
+	struct json_names {
+		json_node local[64];
+		json_node* table;
+		uint32_t size;
+	};
+	inline static bool names_build(json_names& n, const json_heap& h, json_node object) noexcept {
+		//an open addressed table of an object's members. the first member wins when names repeat, like get_child.
+		uint32_t count = 0;
+		for (json_node child = value(h, object).object_or_array.first; child; child = value(h, child).next)
+			++count;
+		n.size = 16;
+		while (n.size < count * 2u)
+			n.size <<= 1;
+		n.table = n.size <= 64 ? n.local : (json_node*)malloc(n.size * sizeof(json_node));
+		if (!n.table)
+			return false;
+		memset(n.table, 0, n.size * sizeof(json_node));
+		for (json_node child = value(h, object).object_or_array.first; child; child = value(h, child).next) {
+			uint32_t slot = names_slot(n, h, value(h, child).name ? chars(h, value(h, child).name) : "");
+			if (!n.table[slot])
+				n.table[slot] = child;
+		}
+		return true;
+	}
+	inline static uint32_t names_slot(const json_names& n, const json_heap& h, json_string name) noexcept {
+		uint32_t slot = uint32_t(hash_chars(name)) & (n.size - 1u);
+		while (n.table[slot] && strcmp(value(h, n.table[slot]).name ? chars(h, value(h, n.table[slot]).name) : "", name) != 0)
+			slot = (slot + 1u) & (n.size - 1u);
+		return slot;
+	}
+	inline static void names_free(json_names& n) noexcept {
+		if (n.table != n.local)
+			free(n.table);
+	}
+	inline static bool equal(const json_heap& ha, json_node a, const json_heap& hb, json_node b) noexcept {
+		//objects compare by name, so member order does not matter. cached hashes reject unequal subtrees early.
+		if (&ha == &hb && a == b)
+			return !ha.is_invalid(a);
+		if (a < ha.m_hashes_capacity && b < hb.m_hashes_capacity && ha.m_hashes[a] && hb.m_hashes[b] && ha.m_hashes[a] != hb.m_hashes[b])
+			return false;
+		json_type type = ha.get_type(a);
+		if (type != hb.get_type(b))
+			return false;
+		if (type == json_type_boolean)
+			return ha.to_boolean(a, false) == hb.to_boolean(b, false);
+		if (type == json_type_number)
+			return ha.to_number(a, 0.0) == hb.to_number(b, 0.0);
+		if (type == json_type_string)
+			return strcmp(ha.to_string(a, ""), hb.to_string(b, "")) == 0;
+		if (type == json_type_array) {
+			json_node ca = ha.get_first(a);
+			json_node cb = hb.get_first(b);
+			for (; ca && cb; ca = ha.get_next(ca), cb = hb.get_next(cb))
+				if (!equal(ha, ca, hb, cb))
+					return false;
+			return !ca && !cb;
+		}
+		if (type == json_type_object) {
+			uint32_t count = 0;
+			for (json_node cb = hb.get_first(b); cb; cb = hb.get_next(cb))
+				++count;
+			json_names names;
+			if (!names_build(names, hb, b))
+				return false;
+			//each member of b may only be matched once, so repeated names in a cannot stand in for missing ones.
+			bool matched_local[64];
+			bool* matched = names.size <= 64 ? matched_local : (bool*)malloc(names.size * sizeof(bool));
+			bool result = matched != 0;
+			if (result)
+				memset(matched, 0, names.size * sizeof(bool));
+			for (json_node ca = ha.get_first(a); result && ca; ca = ha.get_next(ca), --count) {
+				uint32_t slot = names_slot(names, hb, value(ha, ca).name ? chars(ha, value(ha, ca).name) : "");
+				json_node cb = names.table[slot];
+				result = count && cb && !matched[slot] && equal(ha, ca, hb, cb);
+				if (result)
+					matched[slot] = true;
+			}
+			if (matched != matched_local)
+				free(matched);
+			names_free(names);
+			return result && !count;
+		}
+		return type == json_type_null;
+	}
+	inline static json_node nth_child(const json_heap& h, json_node array, uint32_t index) noexcept {
+		json_node child = h.get_first(array);
+		while (child && index--)
+			child = h.get_next(child);
+		return child;
+	}
+	inline static bool pointer_token(json_heap& h, json_string& s) noexcept {
+		//decodes the next reference token of a json pointer into the dump.
+		dump_clear(h);
+		for (++s; *s && *s != '/'; ++s) {
+			json_char c = *s;
+			if (c == '~') {
+				if (s[1] != '0' && s[1] != '1')
+					return false;
+				c = *++s == '0' ? '~' : '/';
+			}
+			if (!dump_char(h, c))
+				return false;
+		}
+		return dump_char(h, '\0');
+	}
+	inline static bool pointer_index(json_string token, uint32_t& index) noexcept {
+		if (!*token || (*token == '0' && token[1]))
+			return false;
+		uint64_t i = 0;
+		for (; *token; ++token) {
+			if (*token < '0' || *token > '9')
+				return false;
+			i = i * 10u + uint32_t(*token - '0');
+			if (i >= std::numeric_limits<uint32_t>::max())
+				return false;
+		}
+		index = uint32_t(i);
+		return true;
+	}
+	inline static json_node pointer_child(const json_heap& h, json_node node, json_string token) noexcept {
+		uint32_t index;
+		if (h.is_object(node))
+			return h.get_child(node, token);
+		if (h.is_array(node) && pointer_index(token, index))
+			return nth_child(h, node, index);
+		return 0;
+	}
+	inline static json_node pointer_parent(json_heap& h, json_node root, json_string pointer) noexcept {
+		//walks every token but the last, which is left decoded in the dump.
+		if (*pointer != '/')
+			return 0;
+		json_node node = root;
+		json_string s = pointer;
+		while (true) {
+			if (!pointer_token(h, s))
+				return 0;
+			if (!*s)
+				return node;
+			if (!(node = pointer_child(h, node, h.m_dump)))
+				return 0;
+		}
+	}
+	inline static json_node pointer_find(json_heap& h, json_node root, json_string pointer) noexcept {
+		if (!*pointer)
+			return root;
+		json_node parent = pointer_parent(h, root, pointer);
+		return parent ? pointer_child(h, parent, h.m_dump) : 0;
+	}
+	inline static bool assign(json_heap& h, json_node node, const json_heap& source, json_node other) noexcept {
+		//replaces a node's value with a copy of another value. the node keeps its id, name, and position.
+		json_type type = source.get_type(other);
+		if (type == json_type_boolean)
+			return h.set_boolean(node, source.to_boolean(other, false));
+		if (type == json_type_number)
+			return h.set_number(node, source.to_number(other, 0.0));
+		if (type == json_type_string)
+			return h.set_string(node, source.to_string(other, ""));
+		if (type == json_type_null)
+			return h.set_null(node);
+		if (type != json_type_object && type != json_type_array)
+			return false;
+		//a detached copy keeps the value alive when it lives inside the node being replaced.
+		json_node copy = copy_subtree(h, source, other, 0, 0);
+		if (!copy)
+			return false;
+		if (!(type == json_type_object ? h.set_object(node) : h.set_array(node)))
+			return false;
+		while (json_node child = value(h, copy).object_or_array.first) {
+			unlink(h, child);
+			link_last(h, child, node);
+		}
+		free_node(h, copy);
+		return true;
+	}
+	inline static bool patch_add(json_heap& h, json_node root, json_string path, const json_heap& source, json_node other) noexcept {
+		if (!*path)
+			return assign(h, root, source, other);
+		json_node parent = pointer_parent(h, root, path);
+		if (h.is_object(parent)) {
+			json_node child = h.get_child(parent, h.m_dump);
+			return child ? assign(h, child, source, other) : copy_subtree(h, source, other, parent, h.m_dump) != 0;
+		}
+		if (!h.is_array(parent))
+			return false;
+		uint32_t index;
+		json_node next = 0;
+		if (strcmp(h.m_dump, "-") != 0) {
+			if (!pointer_index(h.m_dump, index))
+				return false;
+			next = nth_child(h, parent, index);
+			if (!next && index && !nth_child(h, parent, index - 1u))
+				return false;
+		}
+		if (!next)
+			return copy_subtree(h, source, other, parent, 0) != 0;
+		json_node copy = copy_subtree(h, source, other, 0, 0);
+		return copy && h.insert_before(copy, next);
+	}
+	inline static bool patch_move(json_heap& h, json_node root, json_string from, json_string path) noexcept {
+		json_node node = pointer_find(h, root, from);
+		if (!node)
+			return false;
+		if (strcmp(from, path) == 0)
+			return true;
+		if (node == root)
+			return false;
+		//the node is detached first so the path is resolved against the document without it.
+		json_node parent = value(h, node).parent;
+		json_node next = value(h, node).next;
+		unlink(h, node);
+		json_node target = *path ? pointer_parent(h, root, path) : 0;
+		bool moved = false;
+		if (h.is_object(target)) {
+			moved = h.set_name(node, h.m_dump);
+			if (moved) {
+				if (json_node child = h.get_child(target, h.m_dump))
+					h.remove(child);
+				link_last(h, node, target);
+			}
+		}
+		else if (h.is_array(target)) {
+			uint32_t index = 0;
+			json_node before = 0;
+			if (strcmp(h.m_dump, "-") == 0)
+				moved = true;
+			else if (pointer_index(h.m_dump, index)) {
+				before = nth_child(h, target, index);
+				moved = before || !index || nth_child(h, target, index - 1u);
+			}
+			if (moved && before)
+				link_before(h, node, before);
+			else if (moved)
+				link_last(h, node, target);
+		}
+		if (!moved) {
+			if (next)
+				link_before(h, node, next);
+			else
+				link_last(h, node, parent);
+		}
+		return moved;
+	}
+	inline static bool patch_operation(json_heap& h, json_node root, const json_heap& patch, json_node operation) noexcept {
+		json_string op = patch.to_string(patch.get_child(operation, "op"), "");
+		json_string path = patch.to_string(patch.get_child(operation, "path"), 0);
+		if (!path)
+			return false;
+		if (strcmp(op, "add") == 0 || strcmp(op, "replace") == 0 || strcmp(op, "test") == 0) {
+			json_node other = patch.get_child(operation, "value");
+			if (!other)
+				return false;
+			if (*op == 'a')
+				return patch_add(h, root, path, patch, other);
+			json_node node = pointer_find(h, root, path);
+			if (!node)
+				return false;
+			return *op == 'r' ? assign(h, node, patch, other) : equal(h, node, patch, other);
+		}
+		if (strcmp(op, "remove") == 0) {
+			json_node node = pointer_find(h, root, path);
+			return node && node != root && h.remove(node);
+		}
+		json_string from = patch.to_string(patch.get_child(operation, "from"), 0);
+		if (!from)
+			return false;
+		if (strcmp(op, "move") == 0)
+			return patch_move(h, root, from, path);
+		if (strcmp(op, "copy") == 0) {
+			json_node node = pointer_find(h, root, from);
+			return node && patch_add(h, root, path, h, node);
+		}
+		return false;
+	}
+	inline static bool merge_patch(json_heap& h, json_node node, const json_heap& patch, json_node other) noexcept {
+		if (!patch.is_object(other))
+			return assign(h, node, patch, other);
+		if (!h.is_object(node) && !h.set_object(node))
+			return false;
+		for (json_node member = patch.get_first(other); member; member = patch.get_next(member)) {
+			if (!value(patch, member).name)
+				return false;
+			json_string name = chars(patch, value(patch, member).name);
+			json_node child = h.get_child(node, name);
+			if (patch.is_null(member)) {
+				if (child)
+					h.remove(child);
+				continue;
+			}
+			//new members are merged into an empty object so nulls nested in the patch are dropped.
+			if (!child)
+				child = patch.is_object(member) ? h.new_object(node, name) : copy_subtree(h, patch, member, node, name);
+			else if (!patch.is_object(member) && !assign(h, child, patch, member))
+				return false;
+			if (!child || (patch.is_object(member) && !merge_patch(h, child, patch, member)))
+				return false;
+		}
+		return true;
+	}
+
+	//arrays whose unmatched middles need more cells than this are compared by position instead.
+	static constexpr uint64_t max_lcs_cells = 1u << 20;
+	struct json_diff {
+		json_heap& h;
+		json_node patch;
+		const json_heap& source;
+		const json_heap& target;
+		const uint64_t* source_hashes;
+		const uint64_t* target_hashes;
+	};
+	inline static bool diff_push(json_heap& h, json_string token) noexcept {
+		//the dump holds the escaped pointer of the node being compared.
+		if (!dump_char(h, '/'))
+			return false;
+		for (; *token; ++token) {
+			if (*token == '~' || *token == '/') {
+				if (!dump_char(h, '~') || !dump_char(h, *token == '~' ? '0' : '1'))
+					return false;
+			}
+			else if (!dump_char(h, *token))
+				return false;
+		}
+		return true;
+	}
+	inline static bool diff_push(json_heap& h, uint32_t index) noexcept {
+		json_char token[12];
+		snprintf(token, sizeof(token), "%u", index);
+		return diff_push(h, token);
+	}
+	inline static bool diff_emit(json_diff& d, json_string op, const json_node other) noexcept {
+		if (!dump_char(d.h, '\0'))
+			return false;
+		--d.h.m_dump_count;
+		json_node operation = d.h.new_object(d.patch);
+		if (!operation || !d.h.new_string(operation, "op", op) || !d.h.new_string(operation, "path", d.h.m_dump))
+			return false;
+		return !other || copy_subtree(d.h, d.target, other, operation, "value");
+	}
+	inline static bool diff_child(json_diff& d, json_node a, json_node b, json_string name, uint32_t index) noexcept {
+		size_t count = d.h.m_dump_count;
+		bool result = (name ? diff_push(d.h, name) : diff_push(d.h, index)) && diff_node(d, a, b);
+		d.h.m_dump_count = count;
+		return result;
+	}
+	inline static bool diff_emit_child(json_diff& d, json_string op, json_string name, uint32_t index, json_node other) noexcept {
+		size_t count = d.h.m_dump_count;
+		bool result = (name ? diff_push(d.h, name) : diff_push(d.h, index)) && diff_emit(d, op, other);
+		d.h.m_dump_count = count;
+		return result;
+	}
+	inline static bool diff_object(json_diff& d, json_node a, json_node b) noexcept {
+		//the target's members are matched by name through a table, so each source member is found in constant time.
+		json_names names;
+		if (!names_build(names, d.target, b))
+			return false;
+		bool matched_local[64];
+		bool* matched = names.size <= 64 ? matched_local : (bool*)malloc(names.size * sizeof(bool));
+		bool result = matched != 0;
+		if (result)
+			memset(matched, 0, names.size * sizeof(bool));
+		for (json_node child = value(d.source, a).object_or_array.first; result && child; child = value(d.source, child).next) {
+			json_string name = value(d.source, child).name ? chars(d.source, value(d.source, child).name) : "";
+			uint32_t slot = names_slot(names, d.target, name);
+			if (!names.table[slot])
+				result = diff_emit_child(d, "remove", name, 0, 0);
+			else if (!matched[slot]) {
+				matched[slot] = true;
+				result = diff_child(d, child, names.table[slot], name, 0);
+			}
+		}
+		for (json_node child = value(d.target, b).object_or_array.first; result && child; child = value(d.target, child).next) {
+			json_string name = value(d.target, child).name ? chars(d.target, value(d.target, child).name) : "";
+			uint32_t slot = names_slot(names, d.target, name);
+			if (names.table[slot] == child && !matched[slot])
+				result = diff_emit_child(d, "add", name, 0, child);
+		}
+		if (matched != matched_local)
+			free(matched);
+		names_free(names);
+		return result;
+	}
+	inline static bool diff_array(json_diff& d, json_node a, json_node b) noexcept {
+		//common ends are skipped, the rest is aligned by the longest common subsequence of element hashes.
+		uint32_t n = 0;
+		uint32_t m = 0;
+		for (json_node child = value(d.source, a).object_or_array.first; child; child = value(d.source, child).next)
+			++n;
+		for (json_node child = value(d.target, b).object_or_array.first; child; child = value(d.target, child).next)
+			++m;
+		json_node* nodes = (json_node*)malloc((size_t(n) + m + 1u) * sizeof(json_node));
+		if (!nodes)
+			return false;
+		json_node* as = nodes;
+		json_node* bs = nodes + n;
+		uint32_t i = 0;
+		for (json_node child = value(d.source, a).object_or_array.first; child; child = value(d.source, child).next)
+			as[i++] = child;
+		i = 0;
+		for (json_node child = value(d.target, b).object_or_array.first; child; child = value(d.target, child).next)
+			bs[i++] = child;
+		uint32_t prefix = 0;
+		while (prefix < n && prefix < m && d.source_hashes[as[prefix]] == d.target_hashes[bs[prefix]])
+			++prefix;
+		while (n > prefix && m > prefix && d.source_hashes[as[n - 1u]] == d.target_hashes[bs[m - 1u]])
+			--n, --m;
+		as += prefix;
+		bs += prefix;
+		n -= prefix;
+		m -= prefix;
+		bool result = true;
+		uint64_t cells = (uint64_t(n) + 1u) * (uint64_t(m) + 1u);
+		uint32_t* lcs = n && m && cells <= max_lcs_cells ? (uint32_t*)malloc(size_t(cells) * sizeof(uint32_t)) : 0;
+		if (lcs) {
+			//lcs[i * (m + 1) + j] is the common subsequence length of as[i..] and bs[j..].
+			uint32_t w = m + 1u;
+			for (uint32_t x = 0; x <= m; ++x)
+				lcs[size_t(n) * w + x] = 0;
+			for (uint32_t y = n; y-- > 0;) {
+				lcs[size_t(y) * w + m] = 0;
+				for (uint32_t x = m; x-- > 0;)
+					lcs[size_t(y) * w + x] = d.source_hashes[as[y]] == d.target_hashes[bs[x]] ? lcs[size_t(y + 1u) * w + x + 1u] + 1u
+						: std::max(lcs[size_t(y + 1u) * w + x], lcs[size_t(y) * w + x + 1u]);
+			}
+			uint32_t x = 0;
+			uint32_t y = 0;
+			uint32_t k = prefix;
+			while (result && (y < n || x < m)) {
+				if (y < n && x < m && d.source_hashes[as[y]] == d.target_hashes[bs[x]])
+					++y, ++x, ++k;
+				else if (y < n && x < m && lcs[size_t(y) * w + x] == lcs[size_t(y + 1u) * w + x + 1u])
+					result = diff_child(d, as[y++], bs[x++], 0, k++);
+				else if (x == m || (y < n && lcs[size_t(y + 1u) * w + x] >= lcs[size_t(y) * w + x + 1u]))
+					result = diff_emit_child(d, "remove", 0, k, 0), ++y;
+				else
+					result = diff_emit_child(d, "add", 0, k++, bs[x++]);
+			}
+			free(lcs);
+		}
+		else {
+			//arrays too large to align are compared by position.
+			uint32_t common = std::min(n, m);
+			for (uint32_t x = 0; result && x < common; ++x)
+				result = diff_child(d, as[x], bs[x], 0, prefix + x);
+			for (uint32_t x = common; result && x < n; ++x)
+				result = diff_emit_child(d, "remove", 0, prefix + common, 0);
+			for (uint32_t x = common; result && x < m; ++x)
+				result = diff_emit_child(d, "add", 0, prefix + x, bs[x]);
+		}
+		free(nodes);
+		return result;
+	}
+	inline static bool diff_node(json_diff& d, json_node a, json_node b) noexcept {
+		if (d.source_hashes[a] == d.target_hashes[b])
+			return true;
+		json_type type = value(d.source, a).type;
+		if (type != value(d.target, b).type || (type != json_type_object && type != json_type_array))
+			return diff_emit(d, "replace", b);
+		return type == json_type_object ? diff_object(d, a, b) : diff_array(d, a, b);
+	}
+
+	struct json_output {
+		json_heap& heap;
+		const json_style* style;
+		bool measure;
+		size_t length;
+	};
+	inline static bool out_chars(json_output& o, const json_char* s, size_t length) noexcept {
+		//measuring only counts, so it shares every layout decision with saving.
+		if (o.measure) {
+			o.length += length;
+			return true;
+		}
+		if (!dump_grow(o.heap, length))
+			return false;
+		memcpy(o.heap.m_dump + o.heap.m_dump_count, s, length);
+		o.heap.m_dump_count += length;
+		return true;
+	}
+	inline static bool out_string(json_output& o, json_string s) noexcept {
+		if (o.measure) {
+			o.length += escaped_length(s) + 2u;
+			return true;
+		}
+		return dump_char(o.heap, '\"') && dump_string_escaped(o.heap, s) && dump_char(o.heap, '\"');
+	}
+	inline static uint32_t out_indent(const json_output& o, uint32_t depth) noexcept {
+		return o.style->tabs ? depth : depth * o.style->indent;
+	}
+	inline static bool out_line(json_output& o, uint32_t depth) noexcept {
+		//the new line and the whole indentation are written with one grow.
+		static constexpr json_char spaces[] = "                                                                ";
+		static constexpr json_char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+		size_t length = out_indent(o, depth);
+		if (o.measure) {
+			o.length += length + 1u;
+			return true;
+		}
+		if (!dump_grow(o.heap, length + 1u))
+			return false;
+		json_char* out = o.heap.m_dump + o.heap.m_dump_count;
+		const json_char* run = o.style->tabs ? tabs : spaces;
+		size_t size = o.style->tabs ? sizeof(tabs) - 1u : sizeof(spaces) - 1u;
+		*out++ = '\n';
+		for (size_t i = 0; i < length; i += size)
+			memcpy(out + i, run, std::min(size, length - i));
+		o.heap.m_dump_count += length + 1u;
+		return true;
+	}
+	inline static uint32_t scalar_text(const json_heap& h, json_node node, json_char* text, json_string& chars) noexcept {
+		//returns the length of a resolved scalar; numbers are formatted into the text and strings are returned through the chars.
+		const json_value& v = value(h, node);
+		chars = 0;
+		switch (v.type) {
+		case json_type_boolean:
+			return v.boolean.value ? 4u : 5u;
+		case json_type_number:
+			return format_number(v.number.value, text);
+		case json_type_string:
+			chars = json_utils::chars(h, v.string.value);
+			return uint32_t(std::min<size_t>(escaped_length(chars) + 2u, std::numeric_limits<uint32_t>::max()));
+		case json_type_null:
+			return 4u;
+		default:
+			return 0;
+		}
+	}
+	inline static bool out_scalar(json_output& o, json_node node, const json_char* text, json_string chars, uint32_t length) noexcept {
+		const json_value& v = value(o.heap, node);
+		if (v.type == json_type_number)
+			return out_chars(o, text, length);
+		if (v.type == json_type_string)
+			return out_string(o, chars);
+		if (v.type == json_type_boolean)
+			return out_chars(o, v.boolean.value ? "true" : "false", length);
+		return out_chars(o, "null", 4u);
+	}
+	inline static bool is_flat(const json_heap& h, json_node array) noexcept {
+		for (json_node child = value(h, array).object_or_array.first; child; child = value(h, child).next) {
+			resolve(h, child);
+			if (is_container(value(h, child)))
+				return false;
+		}
+		return true;
+	}
+	inline static bool fits_line(const json_heap& h, json_node array, size_t width) noexcept {
+		//stops as soon as the line is too long, so huge arrays are not formatted twice.
+		json_char text[number_chars];
+		json_string chars;
+		size_t length = 2u;
+		for (json_node child = value(h, array).object_or_array.first; child && length <= width; child = value(h, child).next)
+			length += scalar_text(h, child, text, chars) + (child != value(h, array).object_or_array.first ? 2u : 0u);
+		return length <= width;
+	}
+	inline static bool save_flat(json_output& o, json_node array, uint32_t depth, bool wrap) noexcept {
+		//elements are separated by ", " and wrapped to the style's width when the array does not fit on one line.
+		const json_heap& h = o.heap;
+		const size_t width = o.style->array_width;
+		const size_t indent = out_indent(o, depth + 1u);
+		json_char text[number_chars];
+		json_string chars;
+		size_t column = indent;
+		if (!out_chars(o, "[", 1u) || (wrap && !out_line(o, depth + 1u)))
+			return false;
+		for (json_node child = value(h, array).object_or_array.first; child; child = value(h, child).next) {
+			uint32_t length = scalar_text(h, child, text, chars);
+			if (!length)
+				return false;
+			if (child != value(h, array).object_or_array.first) {
+				if (wrap && column + 2u + length > width) {
+					if (!out_chars(o, ",", 1u) || !out_line(o, depth + 1u))
+						return false;
+					column = indent;
+				}
+				else {
+					if (!out_chars(o, ", ", 2u))
+						return false;
+					column += 2u;
+				}
+			}
+			if (!out_scalar(o, child, text, chars, length))
+				return false;
+			column += length;
+		}
+		return (!wrap || out_line(o, depth)) && out_chars(o, "]", 1u);
+	}
+	inline static bool save(json_output& o, json_node source, uint32_t depth = 0) noexcept {
+		//pretty when the output has a style, dense when it does not.
+		json_heap& h = o.heap;
+		//malformed lazy values read as null.
+		if (h.is_invalid(source))
+			return false;
+		resolve(h, source);
+		const json_value& v = value(h, source);
+		if (!is_container(v)) {
+			json_char text[number_chars];
+			json_string chars;
+			uint32_t length = scalar_text(h, source, text, chars);
+			return length && out_scalar(o, source, text, chars, length);
+		}
+		bool object = v.type == json_type_object;
+		json_node first = v.object_or_array.first;
+		if (!first)
+			return out_chars(o, object ? "{}" : "[]", 2u);
+		if (o.style && !object && o.style->array_width && is_flat(h, source))
+			return save_flat(o, source, depth, !fits_line(h, source, o.style->array_width));
+		if (!out_chars(o, object ? "{" : "[", 1u))
+			return false;
+		//a shaped object's names are written from their cached prefixes.
+		uint32_t shape = object ? v.shape & ~shape_dense : 0u;
+		uint32_t key = shape ? h.m_shapes->shapes[shape - 1u].keys : 0u;
+		for (json_node curr = first; curr; curr = value(h, curr).next) {
+			if (curr != first && !out_chars(o, ",", 1u))
+				return false;
+			if (o.style && !out_line(o, depth + 1u))
+				return false;
+			if (shape) {
+				const json_shapes::name& n = h.m_shapes->names[h.m_shapes->keys[key++].name];
+				if (!out_chars(o, chars(h, n.prefix), n.prefix_length) || (o.style && !out_chars(o, " ", 1u)))
+					return false;
+			}
+			else if (object) {
+				json_node name = value(h, curr).name;
+				if (!out_string(o, name ? chars(h, name) : "") || !out_chars(o, ": ", o.style ? 2u : 1u))
+					return false;
+			}
+			if (!save(o, curr, depth + 1u))
+				return false;
+		}
+		if (o.style && !out_line(o, depth))
+			return false;
+		return out_chars(o, object ? "}" : "]", 1u);
+	}
+};
+
+nix::json_heap::~json_heap() noexcept {
+	json_utils::release(*this);
+	free(m_dump);
+}
+nix::json_heap::json_heap() noexcept : json_heap(json_storage_contiguous) {
+
+}
+nix::json_heap::json_heap(json_storage storage) noexcept
+	: m_storage(), m_values_shift(), m_chars_shift(), m_strict(false)
+	, m_values_capacity(0), m_values_count(0), m_values_chunks(0), m_values(0), m_free(0), m_marks(0)
+	, m_hashing(false), m_hashes_capacity(0), m_hashes(0), m_shapes(0)
+	, m_chars_capacity(0), m_chars_count(0), m_lazy_chars(0), m_chars_chunks(0), m_chars(0)
 	, m_dump_capacity(0), m_dump_count(0), m_dump(0) {
+	json_utils::set_storage(*this, storage);
+}
+nix::json_heap::json_heap(const json_heap& source) : json_heap(source.m_storage) {
+	//assign self and copy source.
+	json_utils::copy(*this, source);
+}
+nix::json_heap::json_heap(json_heap&& source) noexcept {
+	//assign self and clear source.
+	json_utils::steal(*this, source);
+}
+nix::json_heap& nix::json_heap::operator=(const json_heap& source) {
+	if (this == &source)
+		return *this;
+	//reuse self if possible; otherwise delete self.
+	if (json_utils::can_copy_in_place(*this, source)) {
+		clear();
+	}
+	else {
+		json_utils::release(*this);
+		json_utils::set_storage(*this, source.m_storage);
+	}
+	//assign self and copy source.
+	json_utils::copy(*this, source);
+	return *this;
+}
+nix::json_heap& nix::json_heap::operator=(json_heap&& source) noexcept {
+	if (this == &source)
+		return *this;
+	//delete self.
+	json_utils::release(*this);
+	free(m_dump);
+	//assign self and clear source.
+	json_utils::steal(*this, source);
+	return *this;
+}
+nix::json_heap nix::json_heap::clone() const {
+	return json_heap(*this);
+}
+
+nix::json_node nix::json_heap::load_file(json_string source, json_format format) noexcept {
+	json_error error;
+	return load_file(source, format, error);
+}
+nix::json_node nix::json_heap::load_file(json_string source, json_format format, json_error& error) noexcept {
+	json_char* text = 0;
+	size_t capacity = 0;
+	size_t length = 0;
+	if (!json_utils::read_file(source, text, capacity, length)) {
+		free(text);
+		error = json_error();
+		error.code = json_error_file;
+		return 0;
+	}
+	nix::json_node node = load_string(text, length, format, error);
+	free(text);
+	return node;
+}
+nix::json_node nix::json_heap::load_string(json_string source, json_format format) noexcept {
+	return load_string(source, strlen(source), format);
+}
+nix::json_node nix::json_heap::load_string(const json_char* source, size_t length, json_format format) noexcept {
+	json_utils::json_failure failure;
+	json_node node = json_utils::load_text(*this, source, length, format, failure);
+	if (!node)
+		json_utils::discard(*this, failure);
+	return node;
+}
+nix::json_node nix::json_heap::load_string(json_string source, json_format format, json_error& error) noexcept {
+	return load_string(source, strlen(source), format, error);
+}
+nix::json_node nix::json_heap::load_string(const json_char* source, size_t length, json_format format, json_error& error) noexcept {
+	json_utils::json_failure failure;
+	json_node node = json_utils::load_text(*this, source, length, format, failure);
+	if (node) {
+		error.code = json_error_none;
+		return node;
+	}
+	//the path is read from the partial nodes, so they are discarded after the report.
+	json_utils::report(*this, source, failure, error);
+	json_utils::discard(*this, failure);
+	return 0;
+}
+nix::json_node nix::json_heap::load_lazy(json_string source) noexcept {
+	size_t length = strlen(source);
+	if (m_strict && !json_utils::is_utf8(source, length))
+		return 0;
+	if (!json_utils::do_whitespace(source))
+		return 0;
+	//decoded strings and names are never longer than the source, so its length plus the pool's first slot is reserved for resolving.
+	uint64_t lazy = uint64_t(m_lazy_chars) + length + 2u;
+	if (lazy > std::numeric_limits<uint32_t>::max() || (m_storage != json_storage_chunked && !reserve_chars(uint32_t(lazy))))
+		return 0;
+	json_node node = json_utils::alloc_lazy(*this, 0, 0, source);
+	if (node)
+		m_lazy_chars = uint32_t(lazy);
+	return node;
+}
+void nix::json_heap::resolve(json_node node) noexcept {
+	if (!is_invalid(node))
+		json_utils::resolve_subtree(*this, node);
+}
+nix::json_string nix::json_heap::save_string(json_node source, json_format format) noexcept {
+	if (format == json_format_pretty)
+		return save_string(source, json_style());
+	if (format != json_format_dense)
+		return 0;
+	json_utils::json_output output = { *this, 0, false, 0 };
+	json_utils::dump_clear(*this);
+	if (!json_utils::save(output, source))
+		return 0;
+	if (!json_utils::dump_char(*this, '\0'))
+		return 0;
+	return m_dump;
+}
+nix::json_string nix::json_heap::save_string(json_node source, const json_style& style) noexcept {
+	json_utils::json_output output = { *this, &style, false, 0 };
+	json_utils::dump_clear(*this);
+	if (!json_utils::save(output, source))
+		return 0;
+	if (!json_utils::dump_char(*this, '\0'))
+		return 0;
+	return m_dump;
+}
+size_t nix::json_heap::measure(json_node source, json_format format) const noexcept {
+	if (format == json_format_pretty)
+		return measure(source, json_style());
+	if (format != json_format_dense)
+		return 0;
+	json_utils::json_output output = { const_cast<json_heap&>(*this), 0, true, 0 };
+	return json_utils::save(output, source) ? output.length : 0;
+}
+size_t nix::json_heap::measure(json_node source, const json_style& style) const noexcept {
+	json_utils::json_output output = { const_cast<json_heap&>(*this), &style, true, 0 };
+	return json_utils::save(output, source) ? output.length : 0;
+}
+bool nix::json_heap::reserve_output(size_t capacity) noexcept {
+	//room for the terminator is included.
+	if (capacity + 1u <= m_dump_capacity)
+		return true;
+	json_char* dump = (json_char*)malloc((capacity + 1u) * sizeof(json_char));
+	if (!dump)
+		return false;
+	if (m_dump_count)
+		memcpy(dump, m_dump, m_dump_count * sizeof(json_char));
+	free(m_dump);
+	m_dump = dump;
+	m_dump_capacity = capacity + 1u;
+	return true;
+}
+nix::json_string nix::json_heap::save_lines(const json_node* nodes, uint32_t count) noexcept {
+	json_utils::json_output output = { *this, 0, false, 0 };
+	json_utils::dump_clear(*this);
+	for (uint32_t i = 0; i < count; ++i)
+		if (!json_utils::save(output, nodes[i]) || !json_utils::dump_char(*this, '\n'))
+			return 0;
+	if (!json_utils::dump_char(*this, '\0'))
+		return 0;
+	return m_dump;
+}
+bool nix::json_heap::save_file(json_node source, json_string destination, json_format format, json_compression compression) noexcept {
+	if (!save_string(source, format))
+		return false;
+	return json_utils::write_file(destination, m_dump, m_dump_count - 1u, compression);
+}
+bool nix::json_heap::validate(const json_char* source, size_t length) noexcept {
+	json_char* out = 0;
+	return json_utils::scan<false>(source, source + length, out) != 0;
+}
+size_t nix::json_heap::minify(const json_char* source, size_t length, json_char* destination) noexcept {
+	json_char* out = destination;
+	if (!json_utils::scan<true>(source, source + length, out))
+		return 0;
+	return size_t(out - destination);
+}
+
+nix::json_node nix::json_heap::new_boolean(json_node object, json_string name, json_boolean value) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_boolean;
+	json_utils::value(*this, node).boolean.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_boolean(json_node array, json_boolean value) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_boolean;
+	json_utils::value(*this, node).boolean.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_boolean(json_boolean value) noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_boolean;
+	json_utils::value(*this, node).boolean.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_number(json_node object, json_string name, json_number value) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_number;
+	json_utils::value(*this, node).number.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_number(json_node array, json_number value) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_number;
+	json_utils::value(*this, node).number.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_number(json_number value) noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_number;
+	json_utils::value(*this, node).number.value = value;
+	return node;
+}
+nix::json_node nix::json_heap::new_string(json_node object, json_string name, json_string value) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_string;
+	json_utils::value(*this, node).string.value = json_utils::alloc_string(*this, value);
+	return node;
+}
+nix::json_node nix::json_heap::new_string(json_node array, json_string value) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_string;
+	json_utils::value(*this, node).string.value = json_utils::alloc_string(*this, value);
+	return node;
+}
+nix::json_node nix::json_heap::new_string(json_string value) noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_string;
+	json_utils::value(*this, node).string.value = json_utils::alloc_string(*this, value);
+	return node;
+}
+nix::json_node nix::json_heap::new_object(json_node object, json_string name) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_object;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_object(json_node array) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_object;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_object() noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_object;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_array(json_node object, json_string name) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_array;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_array(json_node array) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_array;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_array() noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_array;
+	json_utils::value(*this, node).object_or_array = {};
+	return node;
+}
+nix::json_node nix::json_heap::new_null(json_node object, json_string name) noexcept {
+	json_node node = json_utils::alloc_member(*this, object, name);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_null;
+	return node;
+}
+nix::json_node nix::json_heap::new_null(json_node array) noexcept {
+	json_node node = json_utils::alloc_element(*this, array);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_null;
+	return node;
+}
+nix::json_node nix::json_heap::new_null() noexcept {
+	json_node node = json_utils::alloc_node(*this);
+	if (!node) return 0;
+	json_utils::value(*this, node).type = json_type_null;
+	return node;
+}
+nix::json_node nix::json_heap::copy_subtree(const json_heap& source, json_node node, json_node object, json_string name) noexcept {
+	return json_utils::copy_subtree(*this, source, node, object, name);
+}
+nix::json_node nix::json_heap::copy_subtree(const json_heap& source, json_node node, json_node array) noexcept {
+	return json_utils::copy_subtree(*this, source, node, array, 0);
+}
+nix::json_node nix::json_heap::copy_subtree(const json_heap& source, json_node node) noexcept {
+	return json_utils::copy_subtree(*this, source, node, 0, 0);
+}
+
+bool nix::json_heap::remove(json_node node) noexcept {
+	if (is_invalid(node))
+		return false;
+	json_utils::unlink(*this, node);
+	json_utils::free_children(*this, node);
+	json_utils::free_node(*this, node);
+	return true;
+}
+bool nix::json_heap::set_boolean(json_node node, json_boolean value) noexcept {
+	if (!json_utils::set_value(*this, node, json_type_boolean))
+		return false;
+	json_utils::value(*this, node).boolean.value = value;
+	return true;
+}
+bool nix::json_heap::set_number(json_node node, json_number value) noexcept {
+	if (!json_utils::set_value(*this, node, json_type_number))
+		return false;
+	json_utils::value(*this, node).number.value = value;
+	return true;
+}
+bool nix::json_heap::set_string(json_node node, json_string value) noexcept {
+	if (is_invalid(node))
+		return false;
+	json_value& v = json_utils::value(*this, node);
+	json_node chars = json_utils::set_chars(*this, v.type == json_type_string && !v.lazy ? v.string.value : 0, value);
+	if (!chars)
+		return false;
+	json_utils::set_value(*this, node, json_type_string);
+	json_utils::value(*this, node).string.value = chars;
+	return true;
+}
+bool nix::json_heap::set_object(json_node node) noexcept {
+	if (!json_utils::set_value(*this, node, json_type_object))
+		return false;
+	json_utils::value(*this, node).object_or_array = {};
+	return true;
+}
+bool nix::json_heap::set_array(json_node node) noexcept {
+	if (!json_utils::set_value(*this, node, json_type_array))
+		return false;
+	json_utils::value(*this, node).object_or_array = {};
+	return true;
+}
+bool nix::json_heap::set_null(json_node node) noexcept {
+	return json_utils::set_value(*this, node, json_type_null);
+}
+bool nix::json_heap::set_name(json_node node, json_string name) noexcept {
+	if (is_invalid(node))
+		return false;
+	//shared names are never overwritten.
+	json_node id = json_utils::value(*this, node).name;
+	json_node chars = json_utils::set_chars(*this, json_utils::shared_name(*this, id) ? 0 : id, name);
+	if (!chars)
+		return false;
+	json_utils::invalidate(*this, json_utils::value(*this, node).parent);
+	json_utils::value(*this, node).name = chars;
+	return true;
+}
+bool nix::json_heap::move(json_node node, json_node parent) noexcept {
+	if (is_invalid(node) || !(is_object(parent) || is_array(parent)) || !json_utils::resolve(*this, parent))
+		return false;
+	if (json_utils::is_ancestor(*this, node, parent))
+		return false;
+	json_utils::unlink(*this, node);
+	json_utils::link_last(*this, node, parent);
+	return true;
+}
+bool nix::json_heap::insert_before(json_node node, json_node sibling) noexcept {
+	if (is_invalid(node) || is_invalid(sibling) || !json_utils::value(*this, sibling).parent)
+		return false;
+	if (json_utils::is_ancestor(*this, node, sibling))
+		return false;
+	json_utils::unlink(*this, node);
+	json_utils::link_before(*this, node, sibling);
+	return true;
+}
+bool nix::json_heap::apply_patch(json_node root, const json_heap& patch, json_node operations) noexcept {
+	if (is_invalid(root) || !patch.is_array(operations))
+		return false;
+	for (json_node operation = patch.get_first(operations); operation; operation = patch.get_next(operation))
+		if (!json_utils::patch_operation(*this, root, patch, operation))
+			return false;
+	return true;
+}
+bool nix::json_heap::merge_patch(json_node root, const json_heap& patch, json_node merge) noexcept {
+	if (is_invalid(root) || patch.is_invalid(merge))
+		return false;
+	return json_utils::merge_patch(*this, root, patch, merge);
+}
+nix::json_node nix::json_heap::diff(const json_heap& source, json_node node, const json_heap& target, json_node other) noexcept {
+	if (source.is_invalid(node) || target.is_invalid(other))
+		return 0;
+	//hashes are indexed by node id, so lazy nodes are resolved before the tables are sized.
+	json_utils::resolve_subtree(source, node);
+	json_utils::resolve_subtree(target, other);
+	//heaps that cache hashes lend their cache; the others get a table for this diff only, shared when both nodes are in one heap.
+	bool source_cached = source.m_hashing && json_utils::hash_cached(const_cast<json_heap&>(source), node);
+	bool target_cached = target.m_hashing && json_utils::hash_cached(const_cast<json_heap&>(target), other);
+	uint64_t* source_table = source_cached ? 0 : (uint64_t*)malloc((size_t(source.m_values_count) + 1u) * sizeof(uint64_t));
+	uint64_t* target_table = target_cached ? 0 : &source == &target && source_table ? source_table : (uint64_t*)malloc((size_t(target.m_values_count) + 1u) * sizeof(uint64_t));
+	json_node patch = (source_cached || source_table) && (target_cached || target_table) ? new_array() : 0;
+	if (patch) {
+		if (source_table)
+			json_utils::hash_subtree(source, node, source_table);
+		if (target_table)
+			json_utils::hash_subtree(target, other, target_table);
+		json_utils::json_diff d = { *this, patch, source, target, source_table ? source_table : source.m_hashes, target_table ? target_table : target.m_hashes };
+		json_utils::dump_clear(*this);
+		if (!json_utils::diff_node(d, node, other)) {
+			remove(patch);
+			patch = 0;
+		}
+	}
+	if (target_table != source_table)
+		free(target_table);
+	free(source_table);
+	return patch;
+}
+uint64_t nix::json_heap::hash(json_node node) const noexcept {
+	if (is_invalid(node))
+		return 0;
+	json_utils::resolve_subtree(*this, node);
+	uint64_t hash = m_hashing ? json_utils::hash_cached(const_cast<json_heap&>(*this), node) : 0;
+	return hash ? hash : json_utils::hash_value(*this, node, 0);
+}
+bool nix::json_heap::equal(const json_heap& heap, json_node node, const json_heap& other_heap, json_node other) noexcept {
+	if (heap.is_invalid(node) || other_heap.is_invalid(other))
+		return false;
+	return json_utils::equal(heap, node, other_heap, other);
+}
+void nix::json_heap::set_hash_cache(bool enabled) noexcept {
+	m_hashing = enabled;
+	if (!enabled)
+		json_utils::free_hashes(*this);
+}
+bool nix::json_heap::get_hash_cache() const noexcept {
+	return m_hashing;
+}
+bool nix::json_heap::compact() noexcept {
+	//sums the live strings so the new chars are reserved once. shared names are counted by every member, which only reserves more.
+	uint64_t length = 1;
+	uint32_t shared = m_shapes ? uint32_t(m_shapes->names.size()) : 0u;
+	for (uint32_t i = 0; i < shared; ++i)
+		length += m_shapes->names[i].length + m_shapes->names[i].prefix_length + 2u;
+	for (json_node node = 1; node <= m_values_count; ++node) {
+		const json_value& v = json_utils::value(*this, node);
+		if (v.type == json_type_invalid)
+			continue;
+		if (v.name)
+			length += strlen(json_utils::chars(*this, v.name)) + 1;
+		if (v.type == json_type_string && !v.lazy)
+			length += strlen(json_utils::chars(*this, v.string.value)) + 1;
+	}
+	//the room kept for resolving lazy nodes moves with the chars.
+	length += m_lazy_chars;
+	if (length > std::numeric_limits<uint32_t>::max())
+		return false;
+	//new ids are staged so a failed rewrite leaves the heap untouched. shared names are rewritten first and keep being shared.
+	json_heap heap(m_storage);
+	json_node* ids = (json_node*)malloc(((size_t(m_values_count) + 1u) * 2u + size_t(shared) * 2u) * sizeof(json_node));
+	if (!ids || !heap.reserve_chars(uint32_t(length))) {
+		free(ids);
+		return false;
+	}
+	json_node* names = ids + (size_t(m_values_count) + 1u) * 2u;
+	for (uint32_t i = 0; i < shared; ++i) {
+		const json_shapes::name& n = m_shapes->names[i];
+		names[i * 2u + 1u] = 0;
+		if (!(names[i * 2u] = json_utils::alloc_string(heap, json_utils::chars(*this, n.id))) || (n.prefix && !(names[i * 2u + 1u] = json_utils::alloc_string(heap, json_utils::chars(*this, n.prefix))))) {
+			free(ids);
+			return false;
+		}
+	}
+	for (json_node node = 1; node <= m_values_count; ++node) {
+		const json_value& v = json_utils::value(*this, node);
+		ids[node * 2u] = 0;
+		ids[node * 2u + 1u] = 0;
+		if (v.type == json_type_invalid)
+			continue;
+		uint32_t slot = json_utils::shared_name(*this, v.name);
+		if (slot)
+			ids[node * 2u] = names[(slot - 1u) * 2u];
+		else if (v.name && !(ids[node * 2u] = json_utils::alloc_string(heap, json_utils::chars(*this, v.name)))) {
+			free(ids);
+			return false;
+		}
+		if (v.type == json_type_string && !v.lazy && !(ids[node * 2u + 1u] = json_utils::alloc_string(heap, json_utils::chars(*this, v.string.value)))) {
+			free(ids);
+			return false;
+		}
+	}
+	for (json_node node = 1; node <= m_values_count; ++node) {
+		json_value& v = json_utils::value(*this, node);
+		if (v.type == json_type_invalid)
+			continue;
+		v.name = ids[node * 2u];
+		if (v.type == json_type_string && !v.lazy)
+			v.string.value = ids[node * 2u + 1u];
+	}
+	if (m_shapes) {
+		m_shapes->last = 0;
+		for (uint32_t i = 0; i < shared; ++i) {
+			m_shapes->names[i].id = names[i * 2u];
+			m_shapes->names[i].prefix = names[i * 2u + 1u];
+			m_shapes->last = std::max(m_shapes->last, std::max(names[i * 2u], names[i * 2u + 1u]));
+		}
+		for (json_shapes::key& key : m_shapes->keys)
+			key.id = m_shapes->names[key.name].id;
+		json_utils::rehash_shapes(*m_shapes);
+	}
+	free(ids);
+	std::swap(m_chars_capacity, heap.m_chars_capacity);
+	std::swap(m_chars_count, heap.m_chars_count);
+	std::swap(m_chars_chunks, heap.m_chars_chunks);
+	std::swap(m_chars, heap.m_chars);
+	return true;
+}
 
+nix::json_node nix::json_heap::get_child(json_node node, const json_char* name) const noexcept {
+	if (is_object(node) && json_utils::value(*this, node).shape)
+		return json_utils::find_member(*this, node, name);
+	node = get_first(node);
+	while (node) {
+		if (strcmp(name, get_name(node)) == 0)
+			return node;
+		node = get_next(node);
+	}
+	return 0;
 }
-nix::json_heap::json_heap(const json_heap& source) : json_heap() {
-	//assign self and copy source.
-	reserve_chars(source.m_chars_count);
-	reserve_nodes(source.m_values_count);
-	memcpy(m_chars, source.m_chars, source.m_chars_count * sizeof(json_char));
-	memcpy(m_values + 1, source.m_values + 1, source.m_values_count * sizeof(json_value));
-	m_chars_count = source.m_chars_count;
-	m_values_count = source.m_values_count;
+nix::json_node nix::json_heap::get_first(json_node node) const noexcept {
+	if ((is_object(node) || is_array(node)) && json_utils::resolve(*this, node))
+		return json_utils::value(*this, node).object_or_array.first;
+	return 0;
 }
-nix::json_heap::json_heap(json_heap&& source) noexcept {
-	//assign self and clear source.
-	m_values_capacity = source.m_values_capacity;
-	m_values_count = source.m_values_count;
-	m_values = source.m_values;
-	source.m_values = ((json_value*)(0)) - 1;
-	m_chars_capacity = source.m_chars_capacity;
-	m_chars_count = source.m_chars_count;
-	m_chars = source.m_chars;
-	source.m_chars = 0;
-	m_dump_capacity = source.m_dump_capacity;
-	m_dump_count = source.m_dump_count;
-	m_dump = source.m_dump;
-	source.m_dump = 0;
+nix::json_node nix::json_heap::get_next(json_node child) const noexcept {
+	if (is_invalid(child))
+		return 0;
+	return json_utils::value(*this, child).next;
 }
-nix::json_heap& nix::json_heap::operator=(const json_heap& source) {
+nix::json_node nix::json_heap::get_last(json_node node) const noexcept {
+	if ((is_object(node) || is_array(node)) && json_utils::resolve(*this, node))
+		return json_utils::value(*this, node).object_or_array.last;
+	return 0;
+}
+nix::json_node nix::json_heap::get_parent(json_node node) const noexcept {
+	if (is_invalid(node))
+		return 0;
+	return json_utils::value(*this, node).parent;
+}
+uint32_t nix::json_heap::get_shape(json_node node) const noexcept {
+	if (is_invalid(node))
+		return 0;
+	return json_utils::value(*this, node).shape & ~json_utils::shape_dense;
+}
+nix::json_children nix::json_heap::children(json_node node) const noexcept {
+	return json_children(*this, get_first(node));
+}
+nix::json_children nix::json_heap::members(json_node node) const noexcept {
+	return json_children(*this, is_object(node) ? get_first(node) : 0);
+}
+nix::json_descendants nix::json_heap::descendants(json_node node) const noexcept {
+	if (is_invalid(node))
+		return json_descendants();
+	json_utils::resolve_subtree(*this, node);
+	return json_descendants(*this, node);
+}
+uint32_t nix::json_heap::extract_columns(json_node array, const json_string* names, uint32_t count, json_column* columns) const noexcept {
+	if (!is_array(array))
+		return 0;
+	try {
+		return json_utils::extract_columns(*this, array, names, count, columns);
+	}
+	catch (...) {
+		for (uint32_t i = 0; i < count; ++i)
+			columns[i] = json_column();
+		return 0;
+	}
+}
+uint32_t nix::json_heap::extract_columns(json_node array, std::initializer_list<json_string> names, std::vector<json_column>& columns) const noexcept {
+	try {
+		columns.resize(names.size());
+	}
+	catch (...) {
+		return 0;
+	}
+	return extract_columns(array, names.begin(), uint32_t(names.size()), columns.data());
+}
+nix::json_number_stats nix::json_heap::get_number_stats(json_node node, uint32_t threads) const noexcept {
+	json_number_stats stats;
+	json_utils::scan(*this, node, threads, stats);
+	return stats;
+}
+void nix::json_heap::count_types(json_node node, uint64_t (&counts)[7], uint32_t threads) const noexcept {
+	json_utils::json_counts result = {};
+	json_utils::scan(*this, node, threads, result);
+	memcpy(counts, result.counts, sizeof(counts));
+}
+uint32_t nix::json_heap::get_parallel_ranges(uint32_t threads) const noexcept {
+	//small heaps are not worth a thread, so each range has at least 64k nodes.
+	if (!threads)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	return std::min(threads, std::max(1u, m_values_count / 65536u));
+}
+void nix::json_heap::get_parallel_range(uint32_t index, uint32_t count, json_node& first, json_node& last) const noexcept {
+	first = json_node(uint64_t(m_values_count) * index / count + 1u);
+	last = json_node(uint64_t(m_values_count) * (index + 1u) / count);
+}
+void nix::json_heap::run_parallel(uint32_t count, void (*function)(void* context, uint32_t index), void* context) noexcept {
+	//the caller runs the first range. a range whose thread cannot be started runs on the caller too.
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < count; ++i) {
+		try {
+			threads.emplace_back(function, context, i);
+		}
+		catch (...) {
+			function(context, i);
+		}
+	}
+	function(context, 0);
+	for (std::thread& thread : threads)
+		thread.join();
+}
+nix::json_type nix::json_heap::get_type(json_node node) const noexcept {
+	if (is_invalid(node))
+		return json_type_invalid;
+	return json_utils::value(*this, node).type;
+}
+nix::json_string nix::json_heap::get_name(json_node node) const noexcept {
+	if (is_invalid(node))
+		return "invalid";
+	json_node name = json_utils::value(*this, node).name;
+	return name ? json_utils::chars(*this, name) : "nameless";
+}
+
+nix::json_boolean nix::json_heap::to_boolean(json_node node, json_boolean fallback) const noexcept {
+	if (is_boolean(node))
+		return json_utils::value(*this, node).boolean.value;
+	return fallback;
+}
+nix::json_boolean nix::json_heap::to_boolean(json_node node) const {
+	if (!is_boolean(node)) {
+		throw std::exception("[json error] expected boolean.");
+	}
+	return json_utils::value(*this, node).boolean.value;
+}
+nix::json_number nix::json_heap::to_number(json_node node, json_number fallback) const noexcept {
+	if (is_number(node) && json_utils::resolve(*this, node))
+		return json_utils::value(*this, node).number.value;
+	return fallback;
+}
+nix::json_number nix::json_heap::to_number(json_node node) const {
+	if (!is_number(node) || !json_utils::resolve(*this, node)) {
+		throw std::exception("[json error] expected number.\n");
+	}
+	return json_utils::value(*this, node).number.value;
+}
+nix::json_string nix::json_heap::to_string(json_node node, json_string fallback) const noexcept {
+	if (is_string(node) && json_utils::resolve(*this, node))
+		return json_utils::chars(*this, json_utils::value(*this, node).string.value);
+	return fallback;
+}
+nix::json_string nix::json_heap::to_string(json_node node) const {
+	if (!is_string(node) || !json_utils::resolve(*this, node)) {
+		throw std::exception("[json error] expected string.");
+	}
+	return json_utils::chars(*this, json_utils::value(*this, node).string.value);
+}
+
+nix::json_storage nix::json_heap::get_storage() const noexcept {
+	return m_storage;
+}
+void nix::json_heap::set_strict(bool strict) noexcept {
+	m_strict = strict;
+}
+bool nix::json_heap::get_strict() const noexcept {
+	return m_strict;
+}
+bool nix::json_heap::is_utf8(const json_char* source, size_t length) noexcept {
+	return json_utils::is_utf8(source, length);
+}
+
+bool nix::json_heap::is_invalid(json_node node) const noexcept {
+	return (node == 0) || (node > m_values_count) || json_utils::value(*this, node).type == json_type_invalid;
+}
+bool nix::json_heap::is_boolean(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_boolean;
+}
+bool nix::json_heap::is_number(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_number;
+}
+bool nix::json_heap::is_string(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_string;
+}
+bool nix::json_heap::is_object(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_object;
+}
+bool nix::json_heap::is_array(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_array;
+}
+bool nix::json_heap::is_null(json_node node) const noexcept {
+	if (is_invalid(node))
+		return false;
+	return json_utils::value(*this, node).type == json_type_null;
+}
+
+void nix::json_heap::clear() noexcept {
+	m_values_count = 0u;
+	m_free = 0u;
+	m_marks = 0u;
+	m_lazy_chars = 0u;
+	json_utils::clear_hashes(*this);
+	json_utils::clear_shapes(*this);
+	m_chars_count = 0u;
+}
+nix::json_mark nix::json_heap::mark() noexcept {
+	//resolving a lazy node makes nodes and chars. resolved before the mark, they are not lost to a rollback. resolving makes lazy children, which are reached later in the walk.
+	if (m_lazy_chars) {
+		for (json_node node = 1u; node <= m_values_count; ++node)
+			if (json_utils::value(*this, node).lazy)
+				json_utils::resolve_lazy(*this, node);
+		m_lazy_chars = 0;
+	}
+	++m_marks;
+	json_mark mark;
+	mark.nodes = m_values_count;
+	mark.chars = m_chars_count;
+	return mark;
+}
+void nix::json_heap::rollback(const json_mark& mark) noexcept {
+	if (!m_marks || mark.nodes > m_values_count || mark.chars > m_chars_count)
+		return;
+	--m_marks;
+	json_utils::rollback(*this, mark.nodes, mark.chars);
+}
+void nix::json_heap::commit(const json_mark& mark) noexcept {
+	if (m_marks && mark.nodes <= m_values_count)
+		--m_marks;
+}
+void nix::json_heap::reset(bool keep_capacity) noexcept {
+	clear();
+	json_utils::dump_clear(*this);
+	if (keep_capacity)
+		return;
+	json_utils::release(*this);
+	free(m_dump);
+	m_dump = 0;
+	m_dump_capacity = 0;
+}
+void nix::json_heap::shrink_to_fit() noexcept {
+	if (m_storage == json_storage_chunked) {
+		json_utils::shrink_chunked(m_values, m_values_chunks, m_values_capacity, m_values_shift, m_values_count ? m_values_count + 1u : 0u);
+		json_utils::shrink_chunked(m_chars, m_chars_chunks, m_chars_capacity, m_chars_shift, m_chars_count);
+	}
+	else {
+		json_utils::shrink_contiguous(m_values, m_values_chunks, m_values_capacity, m_values_count ? m_values_count + 1u : 0u);
+		json_utils::shrink_contiguous(m_chars, m_chars_chunks, m_chars_capacity, m_chars_count + m_lazy_chars);
+	}
+	json_utils::dump_clear(*this);
+	free(m_dump);
+	m_dump = 0;
+	m_dump_capacity = 0;
+}
+size_t nix::json_heap::get_memory() const noexcept {
+	return size_t(m_values_capacity) * sizeof(json_value) + m_values_chunks * sizeof(json_chunk<json_value>)
+		+ size_t(m_chars_capacity) * sizeof(json_char) + m_chars_chunks * sizeof(json_chunk<json_char>)
+		+ m_dump_capacity * sizeof(json_char) + size_t(m_hashes_capacity) * sizeof(uint64_t)
+		+ (m_shapes ? sizeof(json_shapes) + m_shapes->names.capacity() * sizeof(json_shapes::name) + m_shapes->shapes.capacity() * sizeof(json_shapes::shape)
+			+ m_shapes->keys.capacity() * sizeof(json_shapes::key) + (m_shapes->name_slots.capacity() + m_shapes->shape_slots.capacity()) * sizeof(uint32_t) : 0u);
+}
+bool nix::json_heap::reserve_chars() noexcept {
+	return reserve_chars((m_chars_count + 2u) * 2u);
+}
+bool nix::json_heap::reserve_chars(uint32_t capacity) noexcept {
+	uint64_t ncapacity = uint64_t(m_chars_count) + capacity;
+	if (ncapacity > std::numeric_limits<uint32_t>::max())
+		return false;
+	if (ncapacity <= m_chars_capacity)
+		return true;
+	if (m_storage == json_storage_chunked)
+		return json_utils::grow_chunked(m_chars, m_chars_chunks, m_chars_capacity, m_chars_shift, ncapacity);
+	return json_utils::grow_contiguous(m_chars, m_chars_chunks, m_chars_capacity, m_chars_count, uint32_t(ncapacity));
+}
+bool nix::json_heap::reserve_nodes() noexcept {
+	return reserve_nodes((m_values_count + 2u) * 2u);
+}
+bool nix::json_heap::reserve_nodes(uint32_t capacity) noexcept {
+	//slot zero is reserved for invalid nodes.
+	uint64_t ncapacity = uint64_t(m_values_count) + capacity + 1u;
+	if (ncapacity > std::numeric_limits<uint32_t>::max())
+		return false;
+	if (ncapacity <= m_values_capacity)
+		return true;
+	if (m_storage == json_storage_chunked)
+		return json_utils::grow_chunked(m_values, m_values_chunks, m_values_capacity, m_values_shift, ncapacity);
+	return json_utils::grow_contiguous(m_values, m_values_chunks, m_values_capacity, m_values_count ? m_values_count + 1u : 0u, uint32_t(ncapacity));
+}
+
+nix::json_heap_pool::~json_heap_pool() noexcept {
+	for (uint32_t i = 0; i < m_count; ++i)
+		delete m_heaps[i];
+	free(m_heaps);
+}
+nix::json_heap_pool::json_heap_pool(uint32_t capacity, size_t retain, json_storage storage) noexcept
+	: m_storage(storage), m_retain(retain), m_capacity(0), m_count(0), m_heaps(0) {
+	m_heaps = (json_heap**)malloc(capacity * sizeof(json_heap*));
+	if (m_heaps)
+		m_capacity = capacity;
+}
+
+nix::json_heap* nix::json_heap_pool::acquire() noexcept {
+	if (m_count)
+		return m_heaps[--m_count];
+	return new (std::nothrow) json_heap(m_storage);
+}
+void nix::json_heap_pool::release(json_heap* heap) noexcept {
+	if (!heap)
+		return;
+	//heaps that grew past the high-water mark give their memory back instead of pinning it in the pool.
+	heap->reset(heap->get_memory() <= m_retain);
+	if (m_count < m_capacity)
+		m_heaps[m_count++] = heap;
+	else
+		delete heap;
+}
+uint32_t nix::json_heap_pool::get_count() const noexcept {
+	return m_count;
+}
+
+struct nix::json_path::json_utils {
+	enum kind : uint8_t {
+		kind_member = 0u,
+		kind_pointer = 1u,
+		kind_index = 2u,
+		kind_wildcard = 3u,
+		kind_slice = 4u,
+	};
+	struct query {
+		const json_heap& heap;
+		const json_path& path;
+		json_node* nodes;
+		uint32_t capacity;
+		uint32_t count;
+	};
+
+	inline static json_char* keys(const json_path& p) noexcept {
+		return (json_char*)(p.m_steps + p.m_steps_count);
+	}
+	inline static bool parse_int(json_string& s, int32_t& value) noexcept {
+		char* end;
+		//the largest value marks open slice ends and leaves room for the end of an index, so it is rejected too.
+		long long v = strtoll(s, &end, 10);
+		if (end == s || v < std::numeric_limits<int32_t>::min() || v >= std::numeric_limits<int32_t>::max())
+			return false;
+		s = end;
+		value = int32_t(v);
+		return true;
+	}
+	inline static json_step& add_step(json_path& p, uint8_t kind, bool descendant, uint32_t key) noexcept {
+		json_step& step = p.m_steps[p.m_steps_count++];
+		step = { kind, descendant, key, 0, 0, std::numeric_limits<int32_t>::max(), 1 };
+		return step;
+	}
+	inline static bool compile_pointer(json_path& p, json_string s, json_char* k, uint32_t& l) noexcept {
+		if (!*s)
+			return true;
+		while (*s++ == '/') {
+			json_step& step = add_step(p, kind_pointer, false, l);
+			bool digits = true;
+			for (; *s && *s != '/'; ++s) {
+				json_char c = *s;
+				if (c == '~') {
+					if (s[1] != '0' && s[1] != '1')
+						return false;
+					c = *++s == '0' ? '~' : '/';
+				}
+				digits = digits && c >= '0' && c <= '9';
+				k[l++] = c;
+			}
+			step.length = l - step.key;
+			k[l++] = '\0';
+			//array indices may not have leading zeros.
+			json_string index = k + step.key;
+			if (!digits || !step.length || (step.length > 1 && *index == '0') || !parse_int(index, step.start))
+				step.start = -1;
+			if (!*s)
+				return true;
+		}
+		return false;
+	}
+	inline static bool compile_name(json_path& p, json_string& s, bool descendant, json_char* k, uint32_t& l) noexcept {
+		if (*s == '*') {
+			++s;
+			add_step(p, kind_wildcard, descendant, 0);
+			return true;
+		}
+		json_step& step = add_step(p, kind_member, descendant, l);
+		while (*s && *s != '.' && *s != '[')
+			k[l++] = *s++;
+		step.length = l - step.key;
+		k[l++] = '\0';
+		return step.length != 0;
+	}
+	inline static bool compile_bracket(json_path& p, json_string& s, bool descendant, json_char* k, uint32_t& l) noexcept {
+		++s;
+		if (*s == '*') {
+			++s;
+			add_step(p, kind_wildcard, descendant, 0);
+		}
+		else if (*s == '\'' || *s == '"') {
+			json_char quote = *s++;
+			json_step& step = add_step(p, kind_member, descendant, l);
+			while (*s != quote) {
+				if (*s == '\\')
+					++s;
+				if (!*s)
+					return false;
+				k[l++] = *s++;
+			}
+			++s;
+			step.length = l - step.key;
+			k[l++] = '\0';
+		}
+		else {
+			json_step& step = add_step(p, kind_index, descendant, 0);
+			bool start = parse_int(s, step.start);
+			if (*s == ':') {
+				//slices only step forward so that matches stay in document order.
+				step.kind = kind_slice;
+				++s;
+				if (*s != ':' && *s != ']' && !parse_int(s, step.end))
+					return false;
+				if (*s == ':' && *++s != ']' && (!parse_int(s, step.step) || step.step <= 0))
+					return false;
+			}
+			else if (!start) {
+				return false;
+			}
+		}
+		return *s++ == ']';
+	}
+	inline static bool compile_path(json_path& p, json_string s, json_char* k, uint32_t& l) noexcept {
+		if (*s++ != '$')
+			return false;
+		while (*s) {
+			bool descendant = s[0] == '.' && s[1] == '.';
+			if (descendant)
+				s += 2;
+			else if (*s == '.')
+				++s;
+			else if (*s != '[')
+				return false;
+			if (*s == '[') {
+				if (!compile_bracket(p, s, descendant, k, l))
+					return false;
+			}
+			else if (s[-1] == '.') {
+				if (!compile_name(p, s, descendant, k, l))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	inline static uint32_t length(const json_heap& h, json_node node) noexcept {
+		uint32_t length = 0;
+		for (json_node child = json_heap::json_utils::value(h, node).object_or_array.first; child; child = json_heap::json_utils::value(h, child).next)
+			++length;
+		return length;
+	}
+	inline static bool emit(query& q, uint32_t i, json_node node) noexcept {
+		if (i == q.path.m_steps_count) {
+			q.nodes[q.count++] = node;
+			return q.count < q.capacity;
+		}
+		const json_step& step = q.path.m_steps[i];
+		if (!step.descendant)
+			return apply(q, i, node);
+		//descendant steps apply to the node and everything below it in preorder.
+		json_node curr = node;
+		while (true) {
+			if (!apply(q, i, curr))
+				return false;
+			const json_heap::json_value& v = json_heap::json_utils::value(q.heap, curr);
+			json_node next = (v.type == json_type_object || v.type == json_type_array) ? v.object_or_array.first : 0;
+			while (!next) {
+				if (curr == node)
+					return true;
+				next = json_heap::json_utils::value(q.heap, curr).next;
+				if (next)
+					break;
+				curr = json_heap::json_utils::value(q.heap, curr).parent;
+			}
+			curr = next;
+		}
+	}
+	inline static bool apply(query& q, uint32_t i, json_node node) noexcept {
+		const json_heap& h = q.heap;
+		json_heap::json_utils::resolve(h, node);
+		json_type type = json_heap::json_utils::value(h, node).type;
+		if (type != json_type_object && type != json_type_array)
+			return true;
+		const json_step& step = q.path.m_steps[i];
+		json_string key = keys(q.path) + step.key;
+		int32_t start = step.start;
+		int32_t end = step.end;
+		if (type == json_type_array && step.kind == kind_member)
+			return true;
+		if (type == json_type_object && (step.kind == kind_index || step.kind == kind_slice))
+			return true;
+		if (type == json_type_array && (step.kind == kind_index || step.kind == kind_slice) && (start < 0 || end < 0)) {
+			int32_t count = int32_t(length(h, node));
+			if (start < 0)
+				start = std::max(count + start, step.kind == kind_index ? -1 : 0);
+			if (end < 0)
+				end = std::max(count + end, 0);
+		}
+		if (step.kind == kind_index)
+			end = start + 1;
+		if (type == json_type_array && step.kind == kind_pointer) {
+			end = start + 1;
+			if (start < 0)
+				return true;
+		}
+		int32_t index = 0;
+		for (json_node child = json_heap::json_utils::value(h, node).object_or_array.first; child; child = json_heap::json_utils::value(h, child).next, ++index) {
+			if (type == json_type_object && step.kind != kind_wildcard) {
+				//the key length and first char reject most members before comparing.
+				json_node name = json_heap::json_utils::value(h, child).name;
+				if (!name)
+					continue;
+				json_string n = json_heap::json_utils::chars(h, name);
+				if (*n != *key || strncmp(n, key, step.length + 1) != 0)
+					continue;
+				return emit(q, i + 1, child);
+			}
+			if (type == json_type_array && step.kind != kind_wildcard) {
+				if (index >= end)
+					return true;
+				if (index < start || (index - start) % step.step)
+					continue;
+			}
+			if (!emit(q, i + 1, child))
+				return false;
+		}
+		return true;
+	}
+};
+
+nix::json_path::~json_path() noexcept {
+	free(m_steps);
+}
+nix::json_path::json_path() noexcept
+	: m_valid(false), m_steps_count(0), m_size(0), m_steps(0) {
+
+}
+nix::json_path::json_path(const json_path& source) : json_path() {
+	//steps refer to keys by offset so the block can be copied as is.
+	if (source.m_size) {
+		if (!(m_steps = (json_step*)malloc(source.m_size)))
+			return;
+		memcpy(m_steps, source.m_steps, source.m_size);
+	}
+	m_valid = source.m_valid;
+	m_steps_count = source.m_steps_count;
+	m_size = source.m_size;
+}
+nix::json_path::json_path(json_path&& source) noexcept
+	: m_valid(source.m_valid), m_steps_count(source.m_steps_count), m_size(source.m_size), m_steps(source.m_steps) {
+	source.m_valid = false;
+	source.m_steps_count = 0;
+	source.m_size = 0;
+	source.m_steps = 0;
+}
+nix::json_path& nix::json_path::operator=(const json_path& source) {
 	if (this == &source)
 		return *this;
-	//delete self.
-	free(m_values + 1);
-	free(m_chars);
-	free(m_dump);
-	clear();
-	//assign self and copy source.
-	reserve_chars(source.m_chars_count);
-	reserve_nodes(source.m_values_count);
-	memcpy(m_chars, source.m_chars, source.m_chars_count * sizeof(json_char));
-	memcpy(m_values + 1, source.m_values + 1, source.m_values_count * sizeof(json_value));
-	return *this;
+	json_path copy(source);
+	return *this = std::move(copy);
 }
-nix::json_heap& nix::json_heap::operator=(json_heap&& source) noexcept {
+nix::json_path& nix::json_path::operator=(json_path&& source) noexcept {
 	if (this == &source)
 		return *this;
-	//delete self.
-	free(m_values + 1);
-	free(m_chars);
-	free(m_dump);
-	//assign self and clear source.
-	m_values_capacity = source.m_values_capacity;
-	m_values_count = source.m_values_count;
-	m_values = source.m_values;
-	source.m_values = ((json_value*)(0)) - 1;
-	m_chars_capacity = source.m_chars_capacity;
-	m_chars_count = source.m_chars_count;
-	m_chars = source.m_chars;
-	source.m_chars = 0;
-	m_dump_capacity = source.m_dump_capacity;
-	m_dump_count = source.m_dump_count;
-	m_dump = source.m_dump;
-	source.m_dump = 0;
+	free(m_steps);
+	m_valid = source.m_valid;
+	m_steps_count = source.m_steps_count;
+	m_size = source.m_size;
+	m_steps = source.m_steps;
+	source.m_valid = false;
+	source.m_steps_count = 0;
+	source.m_size = 0;
+	source.m_steps = 0;
 	return *this;
 }
 
-nix::json_node nix::json_heap::load_file(json_string source, json_format format) noexcept {
-	std::ifstream stream(source);
-	if (!stream.good())
-		return 0;
-	std::streampos end = stream.seekg(0, std::ios::end).tellg();
-	stream.seekg(0, std::ios::beg);
-	json_char* str = new json_char[end];
-	stream.read(str, end);
-	nix::json_node node = load_string(str, format);
-	delete[] str;
-	return node;
-}
-nix::json_node nix::json_heap::load_string(json_string source, json_format format) noexcept {
-	if (format == json_format_pretty)
-		return json_utils::load_pretty(*this, source);
-	if (format == json_format_dense)
-		return json_utils::load_dense(*this, source);
-	return 0;
-}
-nix::json_string nix::json_heap::save_string(json_node source, json_format format) noexcept {
-	json_utils::dump_clear(*this);
-	if (format == json_format_pretty) {
-		if (!json_utils::save_pretty(*this, source))
-			return 0;
-		if (!json_utils::dump_char(*this, '\0'))
-			return 0;
-		return m_dump;
+bool nix::json_path::compile(json_string expression) noexcept {
+	free(m_steps);
+	m_valid = false;
+	m_steps_count = 0;
+	m_size = 0;
+	m_steps = 0;
+	//no expression has more steps or key chars than it has chars.
+	size_t length = strlen(expression) + 1;
+	size_t size = length * sizeof(json_step) + length * sizeof(json_char);
+	json_step* steps = (json_step*)malloc(size);
+	if (!steps)
+		return false;
+	m_steps = steps;
+	json_char* keys = (json_char*)(steps + length);
+	uint32_t l = 0;
+	bool valid = *expression == '$' ? json_utils::compile_path(*this, expression, keys, l) : json_utils::compile_pointer(*this, expression, keys, l);
+	if (!valid) {
+		free(steps);
+		m_steps_count = 0;
+		m_steps = 0;
+		return false;
 	}
-	if (format == json_format_dense) {
-		if (!json_utils::save_dense(*this, source))
-			return 0;
-		if (!json_utils::dump_char(*this, '\0'))
-			return 0;
-		return m_dump;
+	//pack the keys right after the steps.
+	memmove(m_steps + m_steps_count, keys, l * sizeof(json_char));
+	m_size = m_steps_count * sizeof(json_step) + l * sizeof(json_char);
+	m_valid = true;
+	if (!m_size) {
+		free(m_steps);
+		m_steps = 0;
 	}
-	return 0;
+	return true;
 }
-
-nix::json_node nix::json_heap::new_boolean(json_node object, json_string name, json_boolean value) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
-	if (!node) return 0;
-	m_values[node].type = json_type_boolean;
-	m_values[node].boolean.value = value;
-	return node;
+uint32_t nix::json_path::select(const json_heap& heap, json_node node, json_node* nodes, uint32_t capacity) const noexcept {
+	if (!m_valid || !capacity || heap.is_invalid(node))
+		return 0;
+	json_utils::query q = { heap, *this, nodes, capacity, 0 };
+	json_utils::emit(q, 0, node);
+	return q.count;
 }
-nix::json_node nix::json_heap::new_boolean(json_node array, json_boolean value) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
-	if (!node) return 0;
-	m_values[node].type = json_type_boolean;
-	m_values[node].boolean.value = value;
-	return node;
+nix::json_node nix::json_path::select(const json_heap& heap, json_node node) const noexcept {
+	json_node first = 0;
+	select(heap, node, &first, 1);
+	return first;
 }
-nix::json_node nix::json_heap::new_boolean(json_boolean value) noexcept {
-	json_node node = json_utils::alloc_node(*this);
-	if (!node) return 0;
-	m_values[node].type = json_type_boolean;
-	m_values[node].boolean.value = value;
-	return node;
+
+nix::json_writer::json_writer(json_heap& heap) noexcept : m_heap(heap), m_cursor(0), m_depth(0) {
+
 }
-nix::json_node nix::json_heap::new_number(json_node object, json_string name, json_number value) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
-	if (!node) return 0;
-	m_values[node].type = json_type_number;
-	m_values[node].number.value = value;
-	return node;
+nix::json_writer::json_writer(json_heap& heap, json_node container) noexcept : m_heap(heap), m_cursor(0), m_depth(0) {
+	//the container is checked once here instead of on every append.
+	if ((heap.is_object(container) || heap.is_array(container)) && json_heap::json_utils::resolve(heap, container))
+		m_cursor = container;
 }
-nix::json_node nix::json_heap::new_number(json_node array, json_number value) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
-	if (!node) return 0;
-	m_values[node].type = json_type_number;
-	m_values[node].number.value = value;
-	return node;
+bool nix::json_writer::reserve(uint32_t nodes, uint32_t chars) noexcept {
+	return m_heap.reserve_nodes(nodes) && m_heap.reserve_chars(chars);
 }
-nix::json_node nix::json_heap::new_number(json_number value) noexcept {
-	json_node node = json_utils::alloc_node(*this);
-	if (!node) return 0;
-	m_values[node].type = json_type_number;
-	m_values[node].number.value = value;
-	return node;
+nix::json_node nix::json_writer::get_cursor() const noexcept {
+	return m_cursor;
 }
-nix::json_node nix::json_heap::new_string(json_node object, json_string name, json_string value) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
-	if (!node) return 0;
-	m_values[node].type = json_type_string;
-	m_values[node].string.value = json_utils::alloc_string(*this, value);
+nix::json_node nix::json_writer::alloc(json_string name, json_type type) noexcept {
+	json_node node;
+	if (m_cursor) {
+		//members of an object must be named; elements of an array never are.
+		json_node chars = 0;
+		if (json_heap::json_utils::value(m_heap, m_cursor).type == json_type_object && (!name || !(chars = json_heap::json_utils::alloc_string(m_heap, name))))
+			return 0;
+		node = json_heap::json_utils::alloc_node(m_heap, m_cursor, chars);
+	}
+	else
+		node = json_heap::json_utils::alloc_node(m_heap);
+	if (node)
+		json_heap::json_utils::value(m_heap, node).type = type;
 	return node;
 }
-nix::json_node nix::json_heap::new_string(json_node array, json_string value) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
+nix::json_node nix::json_writer::begin_object(json_string name) noexcept {
+	json_node node = alloc(name, json_type_object);
 	if (!node) return 0;
-	m_values[node].type = json_type_string;
-	m_values[node].string.value = json_utils::alloc_string(*this, value);
+	json_heap::json_utils::value(m_heap, node).object_or_array = {};
+	m_cursor = node;
+	++m_depth;
 	return node;
 }
-nix::json_node nix::json_heap::new_string(json_string value) noexcept {
-	json_node node = json_utils::alloc_node(*this);
+nix::json_node nix::json_writer::begin_array(json_string name) noexcept {
+	json_node node = alloc(name, json_type_array);
 	if (!node) return 0;
-	m_values[node].type = json_type_string;
-	m_values[node].string.value = json_utils::alloc_string(*this, value);
+	json_heap::json_utils::value(m_heap, node).object_or_array = {};
+	m_cursor = node;
+	++m_depth;
 	return node;
 }
-nix::json_node nix::json_heap::new_object(json_node object, json_string name) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
-	if (!node) return 0;
-	m_values[node].type = json_type_object;
-	m_values[node].object_or_array = {};
+nix::json_node nix::json_writer::end() noexcept {
+	if (!m_depth)
+		return 0;
+	json_node node = m_cursor;
+	m_cursor = json_heap::json_utils::value(m_heap, node).parent;
+	--m_depth;
 	return node;
 }
-nix::json_node nix::json_heap::new_object(json_node array) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
+nix::json_node nix::json_writer::write_boolean(json_string name, json_boolean value) noexcept {
+	json_node node = alloc(name, json_type_boolean);
 	if (!node) return 0;
-	m_values[node].type = json_type_object;
-	m_values[node].object_or_array = {};
+	json_heap::json_utils::value(m_heap, node).boolean.value = value;
 	return node;
 }
-nix::json_node nix::json_heap::new_object() noexcept {
-	json_node node = json_utils::alloc_node(*this);
+nix::json_node nix::json_writer::write_number(json_string name, json_number value) noexcept {
+	json_node node = alloc(name, json_type_number);
 	if (!node) return 0;
-	m_values[node].type = json_type_object;
-	m_values[node].object_or_array = {};
+	json_heap::json_utils::value(m_heap, node).number.value = value;
 	return node;
 }
-nix::json_node nix::json_heap::new_array(json_node object, json_string name) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
+nix::json_node nix::json_writer::write_string(json_string name, json_string value) noexcept {
+	json_node node = alloc(name, json_type_string);
 	if (!node) return 0;
-	m_values[node].type = json_type_array;
-	m_values[node].object_or_array = {};
+	json_heap::json_utils::value(m_heap, node).string.value = json_heap::json_utils::alloc_string(m_heap, value);
 	return node;
 }
-nix::json_node nix::json_heap::new_array(json_node array) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
-	if (!node) return 0;
-	m_values[node].type = json_type_array;
-	m_values[node].object_or_array = {};
-	return node;
+nix::json_node nix::json_writer::write_null(json_string name) noexcept {
+	return alloc(name, json_type_null);
 }
-nix::json_node nix::json_heap::new_array() noexcept {
-	json_node node = json_utils::alloc_node(*this);
-	if (!node) return 0;
-	m_values[node].type = json_type_array;
-	m_values[node].object_or_array = {};
-	return node;
+nix::json_node nix::json_writer::write_boolean(json_boolean value) noexcept {
+	return write_boolean(0, value);
 }
-nix::json_node nix::json_heap::new_null(json_node object, json_string name) noexcept {
-	json_node node = json_utils::alloc_node(*this, object, json_utils::alloc_string(*this, name));
-	if (!node) return 0;
-	m_values[node].type = json_type_null;
-	return node;
+nix::json_node nix::json_writer::write_number(json_number value) noexcept {
+	return write_number(0, value);
 }
-nix::json_node nix::json_heap::new_null(json_node array) noexcept {
-	json_node node = json_utils::alloc_node(*this, array);
-	if (!node) return 0;
-	m_values[node].type = json_type_null;
-	return node;
+nix::json_node nix::json_writer::write_string(json_string value) noexcept {
+	return write_string(0, value);
 }
-nix::json_node nix::json_heap::new_null() noexcept {
-	json_node node = json_utils::alloc_node(*this);
-	if (!node) return 0;
-	m_values[node].type = json_type_null;
-	return node;
+nix::json_node nix::json_writer::write_null() noexcept {
+	return alloc(0, json_type_null);
 }
 
-nix::json_node nix::json_heap::get_child(json_node node, const json_char* name) const noexcept {
-	node = get_first(node);
-	while (node) {
-		if (strcmp(name, get_name(node)) == 0)
-			return node;
-		node = get_next(node);
+struct nix::json_parser::json_utils {
+	using heap_utils = json_heap::json_utils;
+
+	static constexpr size_t block_size = 4096u;
+
+	inline static bool fail(json_parser& p) noexcept {
+		p.m_failed = true;
+		return false;
+	}
+	inline static json_char* alloc(json_parser& p, size_t length) noexcept {
+		//strings live in blocks chained through their first bytes; blocks are only freed with the parser.
+		if (p.m_block_capacity - p.m_block_count < length) {
+			size_t capacity = std::max<size_t>(block_size, length + sizeof(json_char*));
+			json_char* block = (json_char*)malloc(capacity);
+			if (!block)
+				return 0;
+			memcpy(block, &p.m_block, sizeof(json_char*));
+			p.m_block = block;
+			p.m_block_count = sizeof(json_char*);
+			p.m_block_capacity = capacity;
+		}
+		json_char* chars = p.m_block + p.m_block_count;
+		p.m_block_count += length;
+		return chars;
+	}
+	inline static const json_char* string_end(json_parser& p) noexcept {
+		//returns the closing quote of the string at the cursor. zero if there is no string or if it is malformed.
+		const json_char* s = p.m_cursor = heap_utils::scan_whitespace(p.m_cursor, p.m_end);
+		if (s == p.m_end || *s != '"')
+			return 0;
+		const json_char* quote = heap_utils::scan_string(s + 1, p.m_end);
+		if (!quote)
+			fail(p);
+		return quote;
+	}
+};
+
+nix::json_parser::~json_parser() noexcept {
+	while (m_block) {
+		json_char* block = m_block;
+		memcpy(&m_block, block, sizeof(json_char*));
+		free(block);
 	}
-	return 0;
-}
-nix::json_node nix::json_heap::get_first(json_node node) const noexcept {
-	if (is_object(node) || is_array(node))
-		return m_values[node].object_or_array.first;
-	return 0;
-}
-nix::json_node nix::json_heap::get_next(json_node child) const noexcept {
-	if (is_invalid(child))
-		return 0;
-	return m_values[child].next;
-}
-nix::json_node nix::json_heap::get_last(json_node node) const noexcept {
-	if (is_object(node) || is_array(node))
-		return m_values[node].object_or_array.last;
-	return 0;
-}
-nix::json_type nix::json_heap::get_type(json_node node) const noexcept {
-	if (is_invalid(node))
-		return json_type_invalid;
-	return m_values[node].type;
 }
-nix::json_string nix::json_heap::get_name(json_node node) const noexcept {
-	if (is_invalid(node))
-		return "invalid";
-	json_node name = m_values[node].name;
-	return name ? (m_chars + name) : "nameless";
+nix::json_parser::json_parser(const json_char* source, size_t length) noexcept
+	: m_cursor(source), m_end(source + length), m_depth(0), m_first(false), m_failed(false), m_block_count(0), m_block_capacity(0), m_block(0) {
+
 }
+nix::json_parser::json_parser(json_string source) noexcept : json_parser(source, strlen(source)) {
 
-nix::json_boolean nix::json_heap::to_boolean(json_node node, json_boolean fallback) const noexcept {
-	if (is_boolean(node))
-		return m_values[node].boolean.value;
-	return fallback;
 }
-nix::json_boolean nix::json_heap::to_boolean(json_node node) const {
-	if (!is_boolean(node)) {
-		throw std::exception("[json error] expected boolean.");
-	}
-	return m_values[node].boolean.value;
+const nix::json_char* nix::json_parser::get_cursor() const noexcept {
+	return m_cursor;
 }
-nix::json_number nix::json_heap::to_number(json_node node, json_number fallback) const noexcept {
-	if (is_number(node))
-		return m_values[node].number.value;
-	return fallback;
+bool nix::json_parser::is_failed() const noexcept {
+	return m_failed;
 }
-nix::json_number nix::json_heap::to_number(json_node node) const {
-	if (!is_number(node)) {
-		throw std::exception("[json error] expected number.\n");
+bool nix::json_parser::parse_boolean(json_boolean& value) noexcept {
+	const json_char* s = m_cursor = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (m_end - s >= 4 && memcmp(s, "true", 4) == 0) {
+		value = true;
+		m_cursor = s + 4;
+		return true;
 	}
-	return m_values[node].number.value;
-}
-nix::json_string nix::json_heap::to_string(json_node node, json_string fallback) const noexcept {
-	if (is_string(node))
-		return m_chars + m_values[node].string.value;
-	return fallback;
-}
-nix::json_string nix::json_heap::to_string(json_node node) const {
-	if (!is_string(node)) {
-		throw std::exception("[json error] expected string.");
+	if (m_end - s >= 5 && memcmp(s, "false", 5) == 0) {
+		value = false;
+		m_cursor = s + 5;
+		return true;
 	}
-	return m_chars + m_values[node].string.value;
+	return false;
 }
-
-bool nix::json_heap::is_invalid(json_node node) const noexcept {
-	return (node == 0) || (node > m_values_count);
+bool nix::json_parser::parse_number(json_number& value) noexcept {
+	const json_char* s = m_cursor = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (s == m_end || (*s != '-' && (*s < '0' || *s > '9')))
+		return false;
+	const json_char* end = json_utils::heap_utils::scan_number(s, m_end);
+	if (!end)
+		return json_utils::fail(*this);
+	value = json_utils::heap_utils::scan_double(s, end);
+	m_cursor = end;
+	return true;
 }
-bool nix::json_heap::is_boolean(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::parse_string(json_string& value) noexcept {
+	const json_char* quote = json_utils::string_end(*this);
+	if (!quote)
 		return false;
-	return m_values[node].type == json_type_boolean;
+	json_char* chars = json_utils::alloc(*this, size_t(quote - m_cursor));
+	if (!chars)
+		return json_utils::fail(*this);
+	json_char* end = json_utils::heap_utils::decode_chars(m_cursor + 1, quote, chars);
+	if (!end)
+		return json_utils::fail(*this);
+	*end = '\0';
+	value = chars;
+	m_cursor = quote + 1;
+	return true;
 }
-bool nix::json_heap::is_number(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::parse_string(std::string& value) {
+	const json_char* quote = json_utils::string_end(*this);
+	if (!quote)
 		return false;
-	return m_values[node].type == json_type_number;
+	value.resize(size_t(quote - m_cursor));
+	json_char* end = json_utils::heap_utils::decode_chars(m_cursor + 1, quote, &value[0]);
+	if (!end)
+		return json_utils::fail(*this);
+	value.resize(size_t(end - &value[0]));
+	m_cursor = quote + 1;
+	return true;
 }
-bool nix::json_heap::is_string(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::parse_null() noexcept {
+	const json_char* s = m_cursor = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (m_end - s < 4 || memcmp(s, "null", 4) != 0)
 		return false;
-	return m_values[node].type == json_type_string;
+	m_cursor = s + 4;
+	return true;
 }
-bool nix::json_heap::is_object(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::skip() noexcept {
+	json_char* out = 0;
+	const json_char* end = json_utils::heap_utils::scan_value<false>(m_cursor, m_end, out);
+	if (!end)
+		return json_utils::fail(*this);
+	m_cursor = end;
+	return true;
+}
+bool nix::json_parser::begin_object() noexcept {
+	const json_char* s = m_cursor = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (s == m_end || *s != '{')
 		return false;
-	return m_values[node].type == json_type_object;
+	if (m_depth == json_utils::heap_utils::max_depth)
+		return json_utils::fail(*this);
+	++m_depth;
+	m_first = true;
+	m_cursor = s + 1;
+	return true;
 }
-bool nix::json_heap::is_array(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::next_member(const json_char*& name, uint32_t& length) noexcept {
+	const json_char* s = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (s == m_end)
+		return json_utils::fail(*this);
+	if (*s == '}') {
+		--m_depth;
+		m_first = false;
+		m_cursor = s + 1;
 		return false;
-	return m_values[node].type == json_type_array;
+	}
+	if (!m_first) {
+		if (*s != ',')
+			return json_utils::fail(*this);
+		s = json_utils::heap_utils::scan_whitespace(s + 1, m_end);
+	}
+	m_first = false;
+	m_cursor = s;
+	const json_char* quote = json_utils::string_end(*this);
+	if (!quote || size_t(quote - s) > std::numeric_limits<uint32_t>::max())
+		return json_utils::fail(*this);
+	name = s + 1;
+	length = uint32_t(quote - name);
+	if (memchr(name, '\\', length)) {
+		//escaped names are decoded so they compare equal to the bound names.
+		json_char* chars = json_utils::alloc(*this, length);
+		json_char* end = chars ? json_utils::heap_utils::decode_chars(name, quote, chars) : 0;
+		if (!end)
+			return json_utils::fail(*this);
+		name = chars;
+		length = uint32_t(end - chars);
+	}
+	s = json_utils::heap_utils::scan_whitespace(quote + 1, m_end);
+	if (s == m_end || *s != ':')
+		return json_utils::fail(*this);
+	m_cursor = s + 1;
+	return true;
 }
-bool nix::json_heap::is_null(json_node node) const noexcept {
-	if (is_invalid(node))
+bool nix::json_parser::begin_array() noexcept {
+	const json_char* s = m_cursor = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (s == m_end || *s != '[')
+		return false;
+	if (m_depth == json_utils::heap_utils::max_depth)
+		return json_utils::fail(*this);
+	++m_depth;
+	m_first = true;
+	m_cursor = s + 1;
+	return true;
+}
+bool nix::json_parser::next_element() noexcept {
+	const json_char* s = json_utils::heap_utils::scan_whitespace(m_cursor, m_end);
+	if (s == m_end)
+		return json_utils::fail(*this);
+	if (*s == ']') {
+		--m_depth;
+		m_first = false;
+		m_cursor = s + 1;
 		return false;
-	return m_values[node].type == json_type_null;
+	}
+	if (!m_first) {
+		if (*s != ',')
+			return json_utils::fail(*this);
+		s = json_utils::heap_utils::scan_whitespace(s + 1, m_end);
+		if (s == m_end || *s == ']')
+			return json_utils::fail(*this);
+	}
+	m_first = false;
+	m_cursor = s;
+	return true;
 }
 
-void nix::json_heap::clear() noexcept {
-	m_values_count = 0u;
-	m_chars_count = 0u;
+struct nix::json_line_reader::json_utils {
+	using heap_utils = json_heap::json_utils;
+
+	inline static const json_char* line_end(const json_line_reader& r) noexcept {
+		const json_char* end = (const json_char*)memchr(r.m_cursor, '\n', size_t(r.m_end - r.m_cursor));
+		return end ? end : r.m_end;
+	}
+	inline static json_node load(json_heap& h, const json_char* s, const json_char* e, heap_utils::json_failure& f) noexcept {
+		//a malformed record keeps its partial nodes until it has been reported, then callers discard them through the failure. the record is never loaded twice.
+		json_node node = heap_utils::load_text(h, s, size_t(e - s), json_format_dense, f);
+		if (node) {
+			const json_char* rest = heap_utils::skip_whitespace(f.at, e);
+			if (rest == e)
+				return node;
+			//the record is a whole value followed by more text.
+			heap_utils::fail(f, json_error_syntax, rest);
+			f.parent = 0;
+		}
+		return 0;
+	}
+	inline static void load_range(const json_char* s, const json_char* e, json_heap& h, std::vector<json_node>& roots, uint64_t& loaded) noexcept {
+		json_line_reader reader(s, size_t(e - s));
+		try {
+			while (!reader.is_end()) {
+				json_node node = reader.next(h);
+				if (node) {
+					roots.push_back(node);
+					++loaded;
+				}
+			}
+		}
+		catch (...) {
+			//stops at the first record that does not fit in the roots.
+		}
+	}
+};
+
+nix::json_line_reader::json_line_reader(const json_char* source, size_t length) noexcept
+	: m_source(source), m_cursor(source), m_end(source + length), m_line(0) {
+
 }
-bool nix::json_heap::reserve_chars() noexcept {
-	return reserve_chars((m_chars_count + 2u) * 2u);
+nix::json_line_reader::json_line_reader(json_string source) noexcept
+	: m_source(source), m_cursor(source), m_end(source + strlen(source)), m_line(0) {
+
 }
-bool nix::json_heap::reserve_chars(uint32_t capacity) noexcept {
-	uint32_t ncapacity = m_chars_count + capacity;
-	if (ncapacity > m_chars_capacity) {
-		json_char* nchars = (json_char*)malloc(ncapacity * sizeof(json_char));
-		if (!nchars)
-			return false;
-		memcpy(nchars, m_chars, m_chars_count * sizeof(json_char));
-		free(m_chars);
-		m_chars = nchars;
-		m_chars_capacity = ncapacity;
+nix::json_node nix::json_line_reader::next(json_heap& heap) noexcept {
+	if (is_end())
+		return 0;
+	const json_char* line = m_cursor;
+	const json_char* end = json_utils::line_end(*this);
+	m_cursor = end < m_end ? end + 1 : m_end;
+	++m_line;
+	json_utils::heap_utils::json_failure failure;
+	json_node node = json_utils::load(heap, line, end, failure);
+	if (!node)
+		json_utils::heap_utils::discard(heap, failure);
+	return node;
+}
+nix::json_node nix::json_line_reader::next(json_heap& heap, json_error& error) noexcept {
+	if (is_end()) {
+		error.code = json_error_none;
+		return 0;
 	}
-	return true;
+	const json_char* line = m_cursor;
+	const json_char* end = json_utils::line_end(*this);
+	m_cursor = end < m_end ? end + 1 : m_end;
+	++m_line;
+	json_utils::heap_utils::json_failure failure;
+	json_node node = json_utils::load(heap, line, end, failure);
+	if (node) {
+		error.code = json_error_none;
+		return node;
+	}
+	json_utils::heap_utils::report(heap, line, failure, error);
+	json_utils::heap_utils::discard(heap, failure);
+	error.offset += size_t(line - m_source);
+	error.line = m_line;
+	return 0;
 }
-bool nix::json_heap::reserve_nodes() noexcept {
-	return reserve_nodes((m_values_count + 2u) * 2u);
+uint32_t nix::json_line_reader::next(json_heap& heap, json_node* nodes, uint32_t capacity) noexcept {
+	uint32_t count = 0;
+	while (count < capacity && !is_end()) {
+		json_node node = next(heap);
+		if (node)
+			nodes[count++] = node;
+	}
+	return count;
 }
-bool nix::json_heap::reserve_nodes(uint32_t capacity) noexcept {
-	uint32_t ncapacity = m_values_count + capacity;
-	if (ncapacity > m_values_capacity) {
-		json_value* nvalues = (json_value*)malloc(ncapacity * sizeof(json_value));
-		if (!nvalues)
+bool nix::json_line_reader::is_end() noexcept {
+	//blank lines are consumed here so next always starts at a record.
+	while (m_cursor < m_end) {
+		const json_char* end = json_utils::line_end(*this);
+		if (json_utils::heap_utils::scan_whitespace(m_cursor, end) != end)
 			return false;
-		memcpy(nvalues, m_values + 1, m_values_count * sizeof(json_value));
-		free(m_values + 1);
-		m_values = nvalues - 1;
-		m_values_capacity = ncapacity;
+		m_cursor = end < m_end ? end + 1 : m_end;
+		++m_line;
 	}
 	return true;
 }
+uint64_t nix::json_line_reader::get_line() const noexcept {
+	return m_line;
+}
+const nix::json_char* nix::json_line_reader::get_cursor() const noexcept {
+	return m_cursor;
+}
+uint64_t nix::json_line_reader::load_parallel(const json_char* source, size_t length, json_heap* heaps, std::vector<json_node>* roots, uint32_t count) {
+	if (!count)
+		return 0;
+	std::vector<uint64_t> loaded(count, 0);
+	std::vector<std::thread> threads;
+	threads.reserve(count);
+	const json_char* end = source + length;
+	const json_char* start = source;
+	for (uint32_t i = 0; i < count; ++i) {
+		//each range ends after the first line end past its share of the text.
+		const json_char* split = end;
+		if (i + 1u < count) {
+			split = std::max(start, source + size_t(uint64_t(length) * (i + 1u) / count));
+			const json_char* line = (const json_char*)memchr(split, '\n', size_t(end - split));
+			split = line ? line + 1 : end;
+		}
+		if (i + 1u == count) {
+			json_utils::load_range(start, split, heaps[i], roots[i], loaded[i]);
+		}
+		else {
+			try {
+				threads.emplace_back(json_utils::load_range, start, split, std::ref(heaps[i]), std::ref(roots[i]), std::ref(loaded[i]));
+			}
+			catch (...) {
+				//ranges without a thread are loaded by the calling thread.
+				json_utils::load_range(start, split, heaps[i], roots[i], loaded[i]);
+			}
+		}
+		start = split;
+	}
+	uint64_t total = 0;
+	for (std::thread& thread : threads)
+		thread.join();
+	for (uint32_t i = 0; i < count; ++i)
+		total += loaded[i];
+	return total;
+}
+
+struct nix::json_file_reader::json_state {
+	struct json_slot {
+		json_char* text;
+		size_t capacity;
+		size_t length;
+		bool read;
+	};
+	std::vector<std::string> paths;
+	std::vector<json_slot> slots;
+	std::mutex mutex;
+	std::condition_variable changed;
+	//files before loaded were taken by the caller. files from loaded to read wait in their slots.
+	uint32_t count = 0;
+	uint32_t read = 0;
+	uint32_t loaded = 0;
+	bool stopping = false;
+	std::thread thread;
+};
+struct nix::json_file_reader::json_utils {
+	using heap_utils = json_heap::json_utils;
+
+	inline static void read_slot(json_state& s, uint32_t index) noexcept {
+		json_state::json_slot& slot = s.slots[index % s.slots.size()];
+		slot.read = heap_utils::read_file(s.paths[index].c_str(), slot.text, slot.capacity, slot.length);
+	}
+	inline static void run(json_state* s) noexcept {
+		std::unique_lock<std::mutex> lock(s->mutex);
+		for (uint32_t i = 0; i < s->count; ++i) {
+			//a slot is refilled once the caller has loaded the file it held.
+			s->changed.wait(lock, [s, i]() { return s->stopping || i - s->loaded < s->slots.size(); });
+			if (s->stopping)
+				return;
+			lock.unlock();
+			read_slot(*s, i);
+			lock.lock();
+			s->read = i + 1u;
+			s->changed.notify_all();
+		}
+	}
+	inline static json_state* start(const json_string* paths, uint32_t count, uint32_t ahead) noexcept {
+		json_state* s = new (std::nothrow) json_state();
+		if (!s)
+			return 0;
+		try {
+			s->paths.assign(paths, paths + count);
+			s->slots.resize(std::max(1u, std::min(ahead, count)), json_state::json_slot());
+		}
+		catch (...) {
+			delete s;
+			return 0;
+		}
+		s->count = count;
+		try {
+			s->thread = std::thread(run, s);
+		}
+		catch (...) {
+			//without a thread, each file is read by the caller when it is loaded.
+		}
+		return s;
+	}
+	inline static json_state::json_slot& wait(json_state& s) noexcept {
+		if (!s.thread.joinable()) {
+			read_slot(s, s.loaded);
+			s.read = s.loaded + 1u;
+		}
+		std::unique_lock<std::mutex> lock(s.mutex);
+		s.changed.wait(lock, [&s]() { return s.read > s.loaded; });
+		return s.slots[s.loaded % s.slots.size()];
+	}
+	inline static void release(json_state& s) noexcept {
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			++s.loaded;
+		}
+		s.changed.notify_all();
+	}
+};
+
+nix::json_file_reader::~json_file_reader() noexcept {
+	if (!m_state)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->stopping = true;
+	}
+	m_state->changed.notify_all();
+	if (m_state->thread.joinable())
+		m_state->thread.join();
+	for (json_state::json_slot& slot : m_state->slots)
+		free(slot.text);
+	delete m_state;
+}
+nix::json_file_reader::json_file_reader(const json_string* paths, uint32_t count, uint32_t ahead) noexcept
+	: m_state(json_utils::start(paths, count, ahead)) {
+}
+nix::json_file_reader::json_file_reader(const std::vector<std::string>& paths, uint32_t ahead) noexcept
+	: m_state(0) {
+	std::vector<json_string> strings;
+	try {
+		strings.reserve(paths.size());
+		for (const std::string& path : paths)
+			strings.push_back(path.c_str());
+	}
+	catch (...) {
+		return;
+	}
+	m_state = json_utils::start(strings.data(), uint32_t(strings.size()), ahead);
+}
+nix::json_node nix::json_file_reader::next(json_heap& heap, json_format format) noexcept {
+	if (is_end())
+		return 0;
+	json_state::json_slot& slot = json_utils::wait(*m_state);
+	json_node node = slot.read ? heap.load_string(slot.text, slot.length, format) : 0;
+	json_utils::release(*m_state);
+	return node;
+}
+nix::json_node nix::json_file_reader::next(json_heap& heap, json_format format, json_error& error) noexcept {
+	if (is_end()) {
+		error.code = json_error_none;
+		return 0;
+	}
+	json_state::json_slot& slot = json_utils::wait(*m_state);
+	json_node node = 0;
+	if (slot.read) {
+		node = heap.load_string(slot.text, slot.length, format, error);
+	}
+	else {
+		error = json_error();
+		error.code = json_error_file;
+	}
+	json_utils::release(*m_state);
+	return node;
+}
+bool nix::json_file_reader::is_end() const noexcept {
+	//loaded is only changed by the caller, so it can be read without the lock.
+	return !m_state || m_state->loaded >= m_state->count;
+}
+nix::json_string nix::json_file_reader::get_path() const noexcept {
+	if (!m_state || !m_state->loaded)
+		return 0;
+	return m_state->paths[m_state->loaded - 1u].c_str();
+}
+
+struct nix::json_file_writer::json_state {
+	struct json_buffer {
+		json_char* text;
+		size_t capacity;
+	};
+	struct json_job {
+		std::string path;
+		json_buffer buffer;
+		size_t length;
+		std::promise<bool> done;
+	};
+	std::deque<json_job> jobs;
+	//idle buffers are reused by later writes. there are never more than capacity, so returning one does not allocate.
+	std::vector<json_buffer> buffers;
+	std::mutex mutex;
+	std::condition_variable changed;
+	uint32_t capacity = 0;
+	//the queued jobs and the one being written.
+	uint32_t pending = 0;
+	uint32_t failed = 0;
+	json_compression compression = json_compression_none;
+	bool stopping = false;
+	std::thread thread;
+};
+struct nix::json_file_writer::json_utils {
+	using heap_utils = json_heap::json_utils;
+
+	inline static void finish(json_state& s, json_state::json_job& job, bool written) noexcept {
+		//expects the lock to be held.
+		if (job.buffer.text)
+			s.buffers.push_back(job.buffer);
+		job.buffer = json_state::json_buffer();
+		if (!written)
+			++s.failed;
+		--s.pending;
+		job.done.set_value(written);
+		s.changed.notify_all();
+	}
+	inline static void run(json_state* s) noexcept {
+		std::unique_lock<std::mutex> lock(s->mutex);
+		while (true) {
+			s->changed.wait(lock, [s]() { return s->stopping || !s->jobs.empty(); });
+			//queued jobs are written before stopping.
+			if (s->jobs.empty())
+				return;
+			json_state::json_job job = std::move(s->jobs.front());
+			s->jobs.pop_front();
+			lock.unlock();
+			bool written = heap_utils::write_file(job.path.c_str(), job.buffer.text, job.length, s->compression);
+			lock.lock();
+			finish(*s, job, written);
+		}
+	}
+	inline static json_state::json_buffer take(json_state& s) noexcept {
+		//waits for a free place in the queue, which keeps the memory held by queued writes bounded.
+		std::unique_lock<std::mutex> lock(s.mutex);
+		s.changed.wait(lock, [&s]() { return s.pending < s.capacity; });
+		++s.pending;
+		json_state::json_buffer buffer = {};
+		if (!s.buffers.empty()) {
+			buffer = s.buffers.back();
+			s.buffers.pop_back();
+		}
+		return buffer;
+	}
+	inline static void queue(json_state& s, json_state::json_job& job) noexcept {
+		if (!s.thread.joinable()) {
+			bool written = heap_utils::write_file(job.path.c_str(), job.buffer.text, job.length, s.compression);
+			std::lock_guard<std::mutex> lock(s.mutex);
+			finish(s, job, written);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(s.mutex);
+		try {
+			s.jobs.push_back(std::move(job));
+		}
+		catch (...) {
+			finish(s, job, false);
+			return;
+		}
+		s.changed.notify_all();
+	}
+	inline static void fail(json_state& s, json_state::json_job& job) noexcept {
+		std::lock_guard<std::mutex> lock(s.mutex);
+		++s.pending;
+		finish(s, job, false);
+	}
+};
+
+nix::json_file_writer::~json_file_writer() noexcept {
+	if (!m_state)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->stopping = true;
+	}
+	m_state->changed.notify_all();
+	if (m_state->thread.joinable())
+		m_state->thread.join();
+	for (json_state::json_buffer& buffer : m_state->buffers)
+		free(buffer.text);
+	delete m_state;
+}
+nix::json_file_writer::json_file_writer(uint32_t capacity, json_compression compression) noexcept
+	: m_state(new (std::nothrow) json_state()) {
+	if (!m_state)
+		return;
+	m_state->capacity = std::max(1u, capacity);
+	m_state->compression = compression;
+	try {
+		m_state->buffers.reserve(m_state->capacity);
+	}
+	catch (...) {
+		delete m_state;
+		m_state = 0;
+		return;
+	}
+	try {
+		m_state->thread = std::thread(json_utils::run, m_state);
+	}
+	catch (...) {
+		//without a thread, files are written by the caller when they are queued.
+	}
+}
+std::future<bool> nix::json_file_writer::write(json_string destination, const json_char* source, size_t length) {
+	json_state::json_job job = { destination, json_state::json_buffer(), length, std::promise<bool>() };
+	std::future<bool> result = job.done.get_future();
+	if (!m_state) {
+		job.done.set_value(false);
+		return result;
+	}
+	job.buffer = json_utils::take(*m_state);
+	if (!json_utils::heap_utils::reserve_text(job.buffer.text, job.buffer.capacity, length)) {
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		json_utils::finish(*m_state, job, false);
+		return result;
+	}
+	if (length)
+		memcpy(job.buffer.text, source, length * sizeof(json_char));
+	json_utils::queue(*m_state, job);
+	return result;
+}
+std::future<bool> nix::json_file_writer::write(json_string destination, json_heap& heap, json_node source, json_format format) {
+	json_state::json_job job = { destination, json_state::json_buffer(), 0, std::promise<bool>() };
+	std::future<bool> result = job.done.get_future();
+	if (!m_state) {
+		job.done.set_value(false);
+		return result;
+	}
+	if (!heap.save_string(source, format)) {
+		json_utils::fail(*m_state, job);
+		return result;
+	}
+	//the heap's output is swapped with an idle buffer, so the text is never copied.
+	job.buffer = json_utils::take(*m_state);
+	job.length = heap.m_dump_count - 1u;
+	std::swap(job.buffer.text, heap.m_dump);
+	std::swap(job.buffer.capacity, heap.m_dump_capacity);
+	heap.m_dump_count = 0;
+	json_utils::queue(*m_state, job);
+	return result;
+}
+bool nix::json_file_writer::flush() noexcept {
+	if (!m_state)
+		return false;
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	m_state->changed.wait(lock, [this]() { return !m_state->pending; });
+	bool written = !m_state->failed;
+	m_state->failed = 0;
+	return written;
+}
 /*
 MIT License
 
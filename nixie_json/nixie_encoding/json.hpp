@@ -2,6 +2,23 @@
 #ifndef FILE_NIXIE_ENCODING_JSON
 #define FILE_NIXIE_ENCODING_JSON
 #include "cstdint"
+#include "cstring"
+#include "string"
+#include "vector"
+#include "type_traits"
+#include "limits"
+#include "iterator"
+#include "cstddef"
+#include "initializer_list"
+#include "future"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include "xmmintrin.h"
+#define NIXIE_JSON_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define NIXIE_JSON_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define NIXIE_JSON_PREFETCH(address) ((void)(address))
+#endif
 namespace nix {
 	/// <summary>
 	/// Defines the json node types. Note that zero is reserved for invalid nodes.
@@ -16,7 +33,7 @@ namespace nix {
 		json_type_null = 6u,
 	};
 	/// <summary>
-	/// Defines the json formats.
+	/// Defines the json formats. Formats only matter when saving; loading accepts both.
 	/// </summary>
 	enum json_format : uint8_t {
 		/// <summary>
@@ -29,6 +46,32 @@ namespace nix {
 		json_format_dense = 1u,
 	};
 	/// <summary>
+	/// Defines the json storage modes.
+	/// </summary>
+	enum json_storage : uint8_t {
+		/// <summary>
+		/// Nodes and chars live in single buffers that are reallocated as the heap grows.
+		/// </summary>
+		json_storage_contiguous = 0u,
+		/// <summary>
+		/// Nodes and chars live in fixed-size chunks that are never moved once allocated.
+		/// </summary>
+		json_storage_chunked = 1u,
+	};
+	/// <summary>
+	/// Defines the file compressions. Gzip is only available when json.cpp is compiled with NIXIE_JSON_ZLIB defined and linked with zlib.
+	/// </summary>
+	enum json_compression : uint8_t {
+		/// <summary>
+		/// Plain json text.
+		/// </summary>
+		json_compression_none = 0u,
+		/// <summary>
+		/// Json text compressed with gzip.
+		/// </summary>
+		json_compression_gzip = 1u,
+	};
+	/// <summary>
 	/// Defines the type used for json booleans.
 	/// </summary>
 	using json_boolean = bool;
@@ -37,7 +80,7 @@ namespace nix {
 	/// </summary>
 	using json_number = double;
 	/// <summary>
-	/// Defines the type used for json strings. Note that json strings are only valid until the json heap is modified or destroyed.
+	/// Defines the type used for json strings. Note that json strings are only valid until the json heap is modified or destroyed. Heaps with chunked storage keep node strings valid until the heap is cleared or destroyed.
 	/// </summary>
 	using json_string = const char*;
 	/// <summary>
@@ -49,6 +92,148 @@ namespace nix {
 	/// </summary>
 	using json_node = uint32_t;
 	/// <summary>
+	/// Defines why json could not be loaded.
+	/// </summary>
+	enum json_error_code : uint8_t {
+		json_error_none = 0u,
+		/// <summary>
+		/// The file could not be read.
+		/// </summary>
+		json_error_file = 1u,
+		/// <summary>
+		/// The text is not valid utf-8 and the heap is strict.
+		/// </summary>
+		json_error_utf8 = 2u,
+		/// <summary>
+		/// The text ended before the value did.
+		/// </summary>
+		json_error_end = 3u,
+		/// <summary>
+		/// A char that does not fit the json grammar was found.
+		/// </summary>
+		json_error_syntax = 4u,
+		/// <summary>
+		/// A string has a control char or a malformed escape.
+		/// </summary>
+		json_error_string = 5u,
+		/// <summary>
+		/// A number is malformed.
+		/// </summary>
+		json_error_number = 6u,
+		/// <summary>
+		/// The heap could not grow.
+		/// </summary>
+		json_error_memory = 7u,
+	};
+	/// <summary>
+	/// Describes where and why json could not be loaded. Only filled in when loading fails, so successful loads pay nothing for it.
+	/// </summary>
+	struct json_error final {
+		/// <summary>
+		/// Why the json could not be loaded.
+		/// </summary>
+		json_error_code code = json_error_none;
+		/// <summary>
+		/// The offset in bytes from the start of the text.
+		/// </summary>
+		size_t offset = 0u;
+		/// <summary>
+		/// The line, starting at one.
+		/// </summary>
+		uint64_t line = 0u;
+		/// <summary>
+		/// The column in bytes, starting at one.
+		/// </summary>
+		uint64_t column = 0u;
+		/// <summary>
+		/// The json pointer of the last value the parser started, like "/items/3". Empty for the root.
+		/// </summary>
+		std::string path;
+	};
+	/// <summary>
+	/// Represents the size of a heap at some point, so that nodes made afterwards can be rolled back.
+	/// </summary>
+	struct json_mark final {
+		/// <summary>
+		/// The number of node ids in use.
+		/// </summary>
+		uint32_t nodes = 0u;
+		/// <summary>
+		/// The number of chars in use.
+		/// </summary>
+		uint32_t chars = 0u;
+	};
+	/// <summary>
+	/// Describes the numbers found by json_heap::get_number_stats.
+	/// </summary>
+	struct json_number_stats final {
+		/// <summary>
+		/// The number of numbers.
+		/// </summary>
+		uint64_t count = 0u;
+		/// <summary>
+		/// The sum of the numbers.
+		/// </summary>
+		json_number sum = 0.0;
+		/// <summary>
+		/// The smallest number. Positive infinity if there are none.
+		/// </summary>
+		json_number min = std::numeric_limits<json_number>::infinity();
+		/// <summary>
+		/// The largest number. Negative infinity if there are none.
+		/// </summary>
+		json_number max = -std::numeric_limits<json_number>::infinity();
+	};
+	/// <summary>
+	/// Receives one column of json_heap::extract_columns. Buffers are only filled for the types found in the column; a filled buffer has one entry per row.
+	/// </summary>
+	struct json_column final {
+		/// <summary>
+		/// The numbers. Zero where the row is not a number.
+		/// </summary>
+		std::vector<json_number> numbers;
+		/// <summary>
+		/// The booleans as zero or one. Zero where the row is not a boolean.
+		/// </summary>
+		std::vector<uint8_t> booleans;
+		/// <summary>
+		/// Row i's string is chars[offsets[i]] up to chars[offsets[i + 1]], so there is one more offset than rows. Empty where the row is not a string.
+		/// </summary>
+		std::vector<uint32_t> offsets;
+		/// <summary>
+		/// The chars of all strings, without terminators.
+		/// </summary>
+		std::vector<json_char> chars;
+		/// <summary>
+		/// One bit per row, set where the member is missing, null, an object or an array, or where the row is not an object. Always filled.
+		/// </summary>
+		std::vector<uint64_t> nulls;
+		/// <summary>
+		/// The type of each row, which tells a zero, false, or empty string apart from the zeros of other types in a mixed column. json_type_null where the member is missing or the row is not an object. Always filled.
+		/// </summary>
+		std::vector<json_type> types;
+	};
+	struct json_children;
+	struct json_descendants;
+	/// <summary>
+	/// Describes the layout of pretty json. The defaults match json_format_pretty.
+	/// </summary>
+	struct json_style final {
+		/// <summary>
+		/// The number of spaces per depth.
+		/// </summary>
+		uint8_t indent = 2u;
+		/// <summary>
+		/// Indents with one tab per depth instead of spaces.
+		/// </summary>
+		bool tabs = false;
+		/// <summary>
+		/// The line width for arrays without objects or arrays. Such arrays are written on one line if that line is at most this many chars long;
+		/// longer ones are written with as many elements per line as fit, counting tabs as one char. Zero writes every element on its own line.
+		/// </summary>
+		uint32_t array_width = 0u;
+	};
+	/// <summary>
 	/// Represents storage for json objects.
 	/// </summary>
 	struct json_heap final {
@@ -63,6 +248,11 @@ namespace nix {
 		/// <summary>
 		/// Constructs the heap.
 		/// </summary>
+		/// <param name="storage">The storage mode.</param>
+		explicit json_heap(json_storage storage) noexcept;
+		/// <summary>
+		/// Constructs the heap.
+		/// </summary>
 		/// <param name="source">The heap to copy.</param>
 		json_heap(const json_heap& source);
 		/// <summary>
@@ -83,28 +273,141 @@ namespace nix {
 		/// <param name="source">The heap to move.</param>
 		/// <returns>The new heap.</returns>
 		json_heap& operator=(json_heap&& source) noexcept;
+		/// <summary>
+		/// Returns a copy of the heap. Each pool of the copy is made with one allocation; the nodes remain valid in both heaps.
+		/// </summary>
+		/// <returns>The copy.</returns>
+		json_heap clone() const;
 
 		/// <summary>
-		/// Loads the json.
+		/// Loads the json. Gzip files are recognized by their header and decompressed when gzip is available.
 		/// </summary>
 		/// <param name="source">The json source.</param>
 		/// <param name="format">The json format.</param>
 		/// <returns>The json destination. Zero if something went wrong.</returns>
 		json_node load_file(json_string source, json_format format = json_format_pretty) noexcept;
 		/// <summary>
-		/// Loads the json.
+		/// Loads the json and describes why if it could not be loaded. Gzip files are recognized by their header and decompressed when gzip is available.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="format">The json format.</param>
+		/// <param name="error">Receives the reason the json could not be loaded. Only its code is reset if loading succeeds.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_node load_file(json_string source, json_format format, json_error& error) noexcept;
+		/// <summary>
+		/// Loads the json. Every format is read by the same parser, which accepts whitespace wherever json allows it and skips it cheaply when there is none.
+		/// Text after the first value is ignored.
 		/// </summary>
 		/// <param name="source">The json source.</param>
 		/// <param name="format">The json format.</param>
 		/// <returns>The json destination. Zero if something went wrong.</returns>
 		json_node load_string(json_string source, json_format format = json_format_pretty) noexcept;
 		/// <summary>
+		/// Loads the json. Every format is read by the same parser, which accepts whitespace wherever json allows it and skips it cheaply when there is none.
+		/// Text after the first value is ignored.
+		/// </summary>
+		/// <param name="source">The json source. Does not need to be null terminated.</param>
+		/// <param name="length">The json source length.</param>
+		/// <param name="format">The json format.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_node load_string(const json_char* source, size_t length, json_format format = json_format_pretty) noexcept;
+		/// <summary>
+		/// Loads the json and describes why if it could not be loaded.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="format">The json format.</param>
+		/// <param name="error">Receives the reason the json could not be loaded. Only its code is reset if loading succeeds.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_node load_string(json_string source, json_format format, json_error& error) noexcept;
+		/// <summary>
+		/// Loads the json and describes why if it could not be loaded.
+		/// </summary>
+		/// <param name="source">The json source. Does not need to be null terminated.</param>
+		/// <param name="length">The json source length.</param>
+		/// <param name="format">The json format.</param>
+		/// <param name="error">Receives the reason the json could not be loaded. Only its code is reset if loading succeeds.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_node load_string(const json_char* source, size_t length, json_format format, json_error& error) noexcept;
+		/// <summary>
+		/// Loads the json lazily. Only the root is made; values are decoded and children are made the first time they are accessed.
+		/// The source must outlive the heap's lazy nodes; call resolve to decode them early. Resolving modifies the heap, so lazy heaps must not be read from multiple threads.
+		/// Room for every string in the source is reserved up front, so resolving never moves the chars and strings returned earlier stay valid.
+		/// Malformed values read as null when they are resolved, and malformed objects and arrays keep the children resolved before the error.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_node load_lazy(json_string source) noexcept;
+		/// <summary>
+		/// Decodes all lazy values in the node and its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		void resolve(json_node node) noexcept;
+		/// <summary>
 		/// Saves the json.
 		/// </summary>
 		/// <param name="source">The json source.</param>
 		/// <param name="format">The json format.</param>
 		/// <returns>The json destination. Zero if something went wrong.</returns>
 		json_string save_string(json_node source, json_format format = json_format_pretty) noexcept;
+		/// <summary>
+		/// Saves the json as pretty json with a custom layout.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="style">The layout.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_string save_string(json_node source, const json_style& style) noexcept;
+		/// <summary>
+		/// Returns the length of the text save_string would make, without making it.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="format">The json format.</param>
+		/// <returns>The number of chars, excluding the terminator. Zero if the node is invalid.</returns>
+		size_t measure(json_node source, json_format format = json_format_pretty) const noexcept;
+		/// <summary>
+		/// Returns the length of the text save_string would make, without making it.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="style">The layout.</param>
+		/// <returns>The number of chars, excluding the terminator. Zero if the node is invalid.</returns>
+		size_t measure(json_node source, const json_style& style) const noexcept;
+		/// <summary>
+		/// Preallocates memory for the text made by save_string and save_lines. Pair with measure so saving allocates at most once.
+		/// </summary>
+		/// <param name="capacity">The number of chars, excluding the terminator.</param>
+		/// <returns>True if successfull. False if something went wrong.</returns>
+		bool reserve_output(size_t capacity) noexcept;
+		/// <summary>
+		/// Saves the json as newline delimited json (json lines). Each node is saved dense and followed by a new line.
+		/// </summary>
+		/// <param name="nodes">The nodes to save.</param>
+		/// <param name="count">The number of nodes.</param>
+		/// <returns>The json destination. Zero if something went wrong.</returns>
+		json_string save_lines(const json_node* nodes, uint32_t count) noexcept;
+		/// <summary>
+		/// Saves the json to a file.
+		/// </summary>
+		/// <param name="source">The json source.</param>
+		/// <param name="destination">The path of the file. The file is replaced if it exists.</param>
+		/// <param name="format">The json format.</param>
+		/// <param name="compression">The file compression.</param>
+		/// <returns>True if successfull. False if something went wrong.</returns>
+		bool save_file(json_node source, json_string destination, json_format format = json_format_pretty, json_compression compression = json_compression_none) noexcept;
+		/// <summary>
+		/// Returns true if the text is one valid json value surrounded by optional whitespace. Makes no nodes.
+		/// Strings with \u0000 escapes or unpaired surrogates are rejected, as they are when loading.
+		/// </summary>
+		/// <param name="source">The json source. Does not need to be null terminated.</param>
+		/// <param name="length">The json source length.</param>
+		/// <returns>True if the text is valid json.</returns>
+		static bool validate(const json_char* source, size_t length) noexcept;
+		/// <summary>
+		/// Removes all whitespace outside of strings from valid json. Makes no nodes.
+		/// </summary>
+		/// <param name="source">The json source. Does not need to be null terminated.</param>
+		/// <param name="length">The json source length.</param>
+		/// <param name="destination">The json destination. Must hold at least length chars and may be the same as the source. Is not null terminated.</param>
+		/// <returns>The json destination length. Zero if the json is invalid.</returns>
+		static size_t minify(const json_char* source, size_t length, json_char* destination) noexcept;
 
 		/// <summary>
 		/// Makes a node.
@@ -232,6 +535,190 @@ namespace nix {
 		/// <param name="value">The node's value.</param>
 		/// <returns>The node that was made. Zero if something went wrong.</returns>
 		json_node new_null() noexcept;
+		/// <summary>
+		/// Makes a deep copy of a node from another heap or from this heap.
+		/// </summary>
+		/// <param name="source">The heap that owns the node to copy.</param>
+		/// <param name="node">The node to copy.</param>
+		/// <param name="object">The new node's parent.</param>
+		/// <param name="name">The new node's name.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node copy_subtree(const json_heap& source, json_node node, json_node object, json_string name) noexcept;
+		/// <summary>
+		/// Makes a deep copy of a node from another heap or from this heap.
+		/// </summary>
+		/// <param name="source">The heap that owns the node to copy.</param>
+		/// <param name="node">The node to copy.</param>
+		/// <param name="array">The new node's parent.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node copy_subtree(const json_heap& source, json_node node, json_node array) noexcept;
+		/// <summary>
+		/// Makes a deep copy of a node from another heap or from this heap.
+		/// </summary>
+		/// <param name="source">The heap that owns the node to copy.</param>
+		/// <param name="node">The node to copy.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node copy_subtree(const json_heap& source, json_node node) noexcept;
+
+		/// <summary>
+		/// Reads a node into a value. Supports booleans, numbers, strings, vectors, and structs bound with NIXIE_JSON_BINDING.
+		/// Struct members are matched in one pass over the object's children; members missing from the object keep their values.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <param name="value">The value that receives the node.</param>
+		/// <returns>True if the node and all of its known members had the expected types.</returns>
+		template<typename T>
+		bool read(json_node node, T& value) const;
+		/// <summary>
+		/// Makes a node from a value. Supports booleans, numbers, strings, vectors, and structs bound with NIXIE_JSON_BINDING.
+		/// </summary>
+		/// <param name="object">The new node's parent.</param>
+		/// <param name="name">The new node's name.</param>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		template<typename T>
+		json_node write(json_node object, json_string name, const T& value);
+		/// <summary>
+		/// Makes a node from a value. Supports booleans, numbers, strings, vectors, and structs bound with NIXIE_JSON_BINDING.
+		/// </summary>
+		/// <param name="array">The new node's parent.</param>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		template<typename T>
+		json_node write(json_node array, const T& value);
+		/// <summary>
+		/// Makes a node from a value. Supports booleans, numbers, strings, vectors, and structs bound with NIXIE_JSON_BINDING.
+		/// </summary>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		template<typename T>
+		json_node write(const T& value);
+
+		/// <summary>
+		/// Unlinks a node from its parent and frees it and its descendants. Freed nodes are reused by later nodes; their strings are reclaimed by compact.
+		/// </summary>
+		/// <param name="node">The node to remove.</param>
+		/// <returns>True if the node was removed.</returns>
+		bool remove(json_node node) noexcept;
+		/// <summary>
+		/// Replaces a node's value in place. The node keeps its name and position; a replaced object or array frees its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <param name="value">The node's new value.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_boolean(json_node node, json_boolean value) noexcept;
+		/// <summary>
+		/// Replaces a node's value in place. The node keeps its name and position; a replaced object or array frees its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <param name="value">The node's new value.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_number(json_node node, json_number value) noexcept;
+		/// <summary>
+		/// Replaces a node's value in place. The node keeps its name and position; a replaced object or array frees its children. Reuses the old string's chars when the new string fits.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <param name="value">The node's new value.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_string(json_node node, json_string value) noexcept;
+		/// <summary>
+		/// Replaces a node's value with an empty object. The node keeps its name and position; a replaced object or array frees its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_object(json_node node) noexcept;
+		/// <summary>
+		/// Replaces a node's value with an empty array. The node keeps its name and position; a replaced object or array frees its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_array(json_node node) noexcept;
+		/// <summary>
+		/// Replaces a node's value with null. The node keeps its name and position; a replaced object or array frees its children.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <returns>True if the value was replaced.</returns>
+		bool set_null(json_node node) noexcept;
+		/// <summary>
+		/// Renames a node. Reuses the old name's chars when the new name fits.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <param name="name">The node's new name.</param>
+		/// <returns>True if the node was renamed.</returns>
+		bool set_name(json_node node, json_string name) noexcept;
+		/// <summary>
+		/// Unlinks a node from its parent and appends it to another object or array. Fails if the parent is the node or one of its descendants.
+		/// </summary>
+		/// <param name="node">The node to move.</param>
+		/// <param name="parent">The node's new parent.</param>
+		/// <returns>True if the node was moved.</returns>
+		bool move(json_node node, json_node parent) noexcept;
+		/// <summary>
+		/// Unlinks a node from its parent and links it in front of a sibling. Fails if the sibling has no parent or is the node or one of its descendants.
+		/// </summary>
+		/// <param name="node">The node to move.</param>
+		/// <param name="sibling">The node that will follow the moved node.</param>
+		/// <returns>True if the node was moved.</returns>
+		bool insert_before(json_node node, json_node sibling) noexcept;
+		/// <summary>
+		/// Applies a json patch (rfc 6902) in place. Only the nodes named by the operations are touched, and replaced nodes keep their ids, so the root stays valid.
+		/// Operations are applied in order and application stops at the first one that fails; earlier operations stay applied.
+		/// </summary>
+		/// <param name="root">The document to patch.</param>
+		/// <param name="patch">The heap that owns the operations. May be this heap.</param>
+		/// <param name="operations">The array of operations.</param>
+		/// <returns>True if every operation was applied.</returns>
+		bool apply_patch(json_node root, const json_heap& patch, json_node operations) noexcept;
+		/// <summary>
+		/// Applies a json merge patch (rfc 7386) in place. Replaced nodes keep their ids, so the root stays valid.
+		/// </summary>
+		/// <param name="root">The document to patch.</param>
+		/// <param name="patch">The heap that owns the merge patch. May be this heap.</param>
+		/// <param name="merge">The merge patch.</param>
+		/// <returns>True if the merge patch was applied.</returns>
+		bool merge_patch(json_node root, const json_heap& patch, json_node merge) noexcept;
+		/// <summary>
+		/// Makes a json patch (rfc 6902) that turns one node into another. Objects are matched by member name and arrays are aligned by their longest common subsequence. Subtrees with equal hashes are treated as equal and skipped.
+		/// </summary>
+		/// <param name="source">The heap that owns the original node. May be this heap.</param>
+		/// <param name="node">The original node.</param>
+		/// <param name="target">The heap that owns the changed node. May be this heap.</param>
+		/// <param name="other">The changed node.</param>
+		/// <returns>The array of operations that was made. Zero if something went wrong.</returns>
+		json_node diff(const json_heap& source, json_node node, const json_heap& target, json_node other) noexcept;
+		/// <summary>
+		/// Returns a hash of the node's value and descendants. Names of the node itself are not hashed, and objects hash the same regardless of member order.
+		/// With the hash cache enabled, unchanged subtrees are not hashed again.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <returns>The node's hash. Zero if something went wrong.</returns>
+		uint64_t hash(json_node node) const noexcept;
+		/// <summary>
+		/// Returns true if two nodes have equal values and descendants. Objects are equal regardless of member order.
+		/// Cached hashes are used to reject unequal subtrees early; equal hashes are always confirmed by comparing values.
+		/// </summary>
+		/// <param name="heap">The heap that owns the first node.</param>
+		/// <param name="node">The first node.</param>
+		/// <param name="other_heap">The heap that owns the second node. May be the same heap.</param>
+		/// <param name="other">The second node.</param>
+		/// <returns>True if the nodes are equal.</returns>
+		static bool equal(const json_heap& heap, json_node node, const json_heap& other_heap, json_node other) noexcept;
+		/// <summary>
+		/// Enables or disables caching subtree hashes. Cached hashes are dropped as nodes change, so repeated calls to hash, equal, and diff skip unchanged subtrees.
+		/// The cache uses eight bytes per node. Disabled by default.
+		/// </summary>
+		/// <param name="enabled">True to cache subtree hashes.</param>
+		void set_hash_cache(bool enabled) noexcept;
+		/// <summary>
+		/// Returns true if subtree hashes are cached.
+		/// </summary>
+		/// <returns>True if subtree hashes are cached.</returns>
+		bool get_hash_cache() const noexcept;
+		/// <summary>
+		/// Rewrites the chars so only the names and strings of live nodes remain. Node ids are kept, but strings returned earlier are invalidated.
+		/// </summary>
+		/// <returns>True if the chars were rewritten.</returns>
+		bool compact() noexcept;
 
 		/// <summary>
 		/// Returns the node's child with the specified name.
@@ -259,6 +746,89 @@ namespace nix {
 		/// <returns>The node's last child. Zero if the child could not be found or if something went wrong.</returns>
 		json_node get_last(json_node node) const noexcept;
 		/// <summary>
+		/// Returns the node's parent.
+		/// </summary>
+		/// <param name="node">The node.</param>
+		/// <returns>The node's parent. Zero if the node has no parent or if something went wrong.</returns>
+		json_node get_parent(json_node node) const noexcept;
+		/// <summary>
+		/// Returns the object's shape. Loading shares repeated names between members, and objects loaded with the same names in the same order get the same shape.
+		/// Members of a shaped object are found by index and its names are written from a cache. Changing the object's members or their names drops its shape.
+		/// </summary>
+		/// <param name="node">The object.</param>
+		/// <returns>The object's shape. Zero if the object has no shape or if something went wrong.</returns>
+		uint32_t get_shape(json_node node) const noexcept;
+		/// <summary>
+		/// Returns the node's children for range based for loops. The node is checked once, so stepping only follows the sibling links.
+		/// </summary>
+		/// <param name="node">The object or array.</param>
+		/// <returns>The node's children. Empty if the node has none or if something went wrong.</returns>
+		json_children children(json_node node) const noexcept;
+		/// <summary>
+		/// Returns the object's members for range based for loops. Same as children, but empty for anything but objects.
+		/// </summary>
+		/// <param name="node">The object.</param>
+		/// <returns>The object's members. Empty if the node has none or if something went wrong.</returns>
+		json_children members(json_node node) const noexcept;
+		/// <summary>
+		/// Returns the node's descendants in depth first order, so a whole document can be passed to std::for_each and other algorithms. Lazy descendants are resolved first.
+		/// </summary>
+		/// <param name="node">The node. Not part of the range.</param>
+		/// <returns>The node's descendants. Empty if the node has none or if something went wrong.</returns>
+		json_descendants descendants(json_node node) const noexcept;
+		/// <summary>
+		/// Calls a function for every live node of a type. The node table is split into ranges that are visited by several threads at once, so the order is unspecified.
+		/// The function must not throw or change the heap. Lazy nodes are not resolved, so their unloaded children are not visited.
+		/// </summary>
+		/// <param name="type">The type of the visited nodes. json_type_invalid visits every live node.</param>
+		/// <param name="function">The function, called as function(node).</param>
+		/// <param name="threads">The most threads to use. Zero uses one per core. Small heaps use fewer.</param>
+		template<typename F>
+		void for_each_node(json_type type, F function, uint32_t threads = 0u) const;
+		/// <summary>
+		/// Maps every live node of a type and combines the results. The node table is split into ranges that are reduced by several threads at once, then the ranges are combined in order.
+		/// The functions must not throw or change the heap. Lazy nodes are not resolved, so their unloaded children are not visited.
+		/// </summary>
+		/// <param name="type">The type of the visited nodes. json_type_invalid visits every live node.</param>
+		/// <param name="identity">The value each range starts from. Combining it with any value must return that value.</param>
+		/// <param name="map">The function that maps a node, called as map(node).</param>
+		/// <param name="combine">The function that combines two results, called as combine(a, b). Must be associative.</param>
+		/// <param name="threads">The most threads to use. Zero uses one per core. Small heaps use fewer.</param>
+		/// <returns>The combined result.</returns>
+		template<typename T, typename M, typename C>
+		T reduce(json_type type, T identity, M map, C combine, uint32_t threads = 0u) const;
+		/// <summary>
+		/// Copies members of an array of objects into one column per member, walking the array once. Rows that lay out their members like an earlier row skip the name lookup.
+		/// </summary>
+		/// <param name="array">The array of objects.</param>
+		/// <param name="names">The member names, one per column.</param>
+		/// <param name="count">The number of columns.</param>
+		/// <param name="columns">Receives the columns. Earlier contents are cleared.</param>
+		/// <returns>The number of rows. Zero if the array is empty or if something went wrong.</returns>
+		uint32_t extract_columns(json_node array, const json_string* names, uint32_t count, json_column* columns) const noexcept;
+		/// <summary>
+		/// Copies members of an array of objects into one column per member, walking the array once. Rows that lay out their members like an earlier row skip the name lookup.
+		/// </summary>
+		/// <param name="array">The array of objects.</param>
+		/// <param name="names">The member names, one per column.</param>
+		/// <param name="columns">Receives the columns. Resized to one per name.</param>
+		/// <returns>The number of rows. Zero if the array is empty or if something went wrong.</returns>
+		uint32_t extract_columns(json_node array, std::initializer_list<json_string> names, std::vector<json_column>& columns) const noexcept;
+		/// <summary>
+		/// Sums the numbers in a subtree and finds the smallest and largest one. Large subtrees are split between several threads.
+		/// </summary>
+		/// <param name="node">The subtree, including the node itself. Zero scans every node in the heap.</param>
+		/// <param name="threads">The most threads to use. Zero uses one per core. Small subtrees use fewer.</param>
+		/// <returns>The number stats.</returns>
+		json_number_stats get_number_stats(json_node node, uint32_t threads = 0u) const noexcept;
+		/// <summary>
+		/// Counts the nodes of each type in a subtree. Large subtrees are split between several threads.
+		/// </summary>
+		/// <param name="node">The subtree, including the node itself. Zero scans every node in the heap, and removed nodes are counted as json_type_invalid.</param>
+		/// <param name="counts">Receives the counts, indexed by json_type.</param>
+		/// <param name="threads">The most threads to use. Zero uses one per core. Small subtrees use fewer.</param>
+		void count_types(json_node node, uint64_t (&counts)[7], uint32_t threads = 0u) const noexcept;
+		/// <summary>
 		/// Returns the node's type.
 		/// </summary>
 		/// <param name="node">The node.</param>
@@ -311,6 +881,29 @@ namespace nix {
 		/// <returns>The value of the node.</returns>
 		json_string to_string(json_node node) const;
 
+		/// <summary>
+		/// Returns the heap's storage mode.
+		/// </summary>
+		/// <returns>The heap's storage mode.</returns>
+		json_storage get_storage() const noexcept;
+		/// <summary>
+		/// Sets whether the heap is strict. Strict heaps only load sources that are valid utf-8.
+		/// </summary>
+		/// <param name="strict">True to make the heap strict.</param>
+		void set_strict(bool strict) noexcept;
+		/// <summary>
+		/// Returns true if the heap is strict.
+		/// </summary>
+		/// <returns>True if the heap is strict.</returns>
+		bool get_strict() const noexcept;
+		/// <summary>
+		/// Returns true if the text is valid utf-8.
+		/// </summary>
+		/// <param name="source">The text.</param>
+		/// <param name="length">The text length.</param>
+		/// <returns>True if the text is valid utf-8.</returns>
+		static bool is_utf8(const json_char* source, size_t length) noexcept;
+
 		/// <summary>
 		/// Returns true if the node is invalid.
 		/// </summary>
@@ -359,14 +952,44 @@ namespace nix {
 		/// </summary>
 		void clear() noexcept;
 		/// <summary>
-		/// Preallocates memory for chars to reduce allocation overhead when creating json strings. Does nothing if the requested memory is already reserved. Requests enough memory to double the memory usage.
+		/// Marks the heap so that nodes made afterwards can be rolled back. Removed nodes are not reused until the mark is rolled back or committed, so every new node gets an id above the mark. Marks nest; close the newest first. Clearing or compacting the heap invalidates marks.
+		/// Lazy nodes are resolved first, so reading them while the mark is open does not make nodes that a rollback would take away.
 		/// </summary>
-		/// <returns>True if successfull. False if something went wrong.</returns>
-		bool reserve_chars() noexcept;
+		/// <returns>The mark.</returns>
+		json_mark mark() noexcept;
 		/// <summary>
-		/// Preallocates memory for chars to reduce allocation overhead when creating json strings. Does nothing if the requested memory is already reserved.
+		/// Removes every node and string made since the mark and closes it. Older nodes lose the children they gained, but other changes to them are not undone, so they must not be set, renamed or moved while the mark is open.
+		/// </summary>
+		/// <param name="mark">The newest open mark.</param>
+		void rollback(const json_mark& mark) noexcept;
+		/// <summary>
+		/// Keeps every node made since the mark and closes it.
+		/// </summary>
+		/// <param name="mark">The newest open mark.</param>
+		void commit(const json_mark& mark) noexcept;
+		/// <summary>
+		/// Clears all nodes, strings, and the saved json.
+		/// </summary>
+		/// <param name="keep_capacity">True to keep the reserved memory for reuse. False to release it.</param>
+		void reset(bool keep_capacity) noexcept;
+		/// <summary>
+		/// Releases reserved memory that is not used by nodes or strings. Also releases the saved json.
+		/// </summary>
+		void shrink_to_fit() noexcept;
+		/// <summary>
+		/// Returns the number of bytes reserved by the heap.
+		/// </summary>
+		/// <returns>The number of bytes reserved by the heap.</returns>
+		size_t get_memory() const noexcept;
+		/// <summary>
+		/// Preallocates memory for chars to reduce allocation overhead when creating json strings. Does nothing if the requested memory is already reserved. Requests enough memory to double the memory usage.
 		/// </summary>
-		/// <param name="capacity">The char capacity.</param>
+		/// <returns>True if successfull. False if something went wrong.</returns>
+		bool reserve_chars() noexcept;
+		/// <summary>
+		/// Preallocates memory for chars to reduce allocation overhead when creating json strings. Does nothing if the requested memory is already reserved.
+		/// </summary>
+		/// <param name="capacity">The char capacity.</param>
 		/// <returns>True if successfull. False if something went wrong.</returns>
 		bool reserve_chars(uint32_t capacity) noexcept;
 		/// <summary>
@@ -382,6 +1005,15 @@ namespace nix {
 		bool reserve_nodes(uint32_t capacity) noexcept;
 
 	private:
+		friend struct json_path;
+		friend struct json_writer;
+		friend struct json_parser;
+		friend struct json_line_reader;
+		friend struct json_file_reader;
+		friend struct json_file_writer;
+		friend struct json_child_iterator;
+		friend struct json_descendant_iterator;
+		friend struct json_descendants;
 		struct json_utils;
 		struct json_value {
 			union {
@@ -389,24 +1021,1132 @@ namespace nix {
 				struct { json_number value; } number;
 				struct { json_node value; } string;
 				struct { json_node first, last; } object_or_array;
+				struct { json_string value; } source;
 			};
 			json_node parent;
 			json_node name;
 			json_node next;
 			json_type type;
+			bool lazy;
+			//the id of a loaded object's names, or zero. the top bit marks members with consecutive ids.
+			uint16_t shape;
 		};
+		struct json_shapes;
+		template<typename T>
+		struct json_chunk {
+			T* data;
+			bool owner;
+		};
+
+		const json_value& get_value(json_node node) const noexcept;
+		json_string get_chars(json_node id) const noexcept;
+		uint32_t get_parallel_ranges(uint32_t threads) const noexcept;
+		void get_parallel_range(uint32_t index, uint32_t count, json_node& first, json_node& last) const noexcept;
+		static void run_parallel(uint32_t count, void (*function)(void* context, uint32_t index), void* context) noexcept;
 
+		json_storage m_storage;
+		uint8_t m_values_shift;
+		uint8_t m_chars_shift;
+		bool m_strict;
 		uint32_t m_values_capacity;
 		uint32_t m_values_count;
-		json_value* m_values;
+		uint32_t m_values_chunks;
+		json_chunk<json_value>* m_values;
+		json_node m_free;
+		uint32_t m_marks;
+		bool m_hashing;
+		uint32_t m_hashes_capacity;
+		uint64_t* m_hashes;
+		json_shapes* m_shapes;
 		uint32_t m_chars_capacity;
 		uint32_t m_chars_count;
-		json_char* m_chars;
+		uint32_t m_lazy_chars;
+		uint32_t m_chars_chunks;
+		json_chunk<json_char>* m_chars;
 		size_t m_dump_capacity;
 		size_t m_dump_count;
 		json_char* m_dump;
 	};
+	/// <summary>
+	/// Represents a pool of reusable json heaps. Heaps keep their memory between uses so handing one out does not allocate. Pools are not thread safe; use one pool per thread.
+	/// </summary>
+	struct json_heap_pool final {
+		/// <summary>
+		/// Deconstructs the pool and all idle heaps.
+		/// </summary>
+		~json_heap_pool() noexcept;
+		/// <summary>
+		/// Constructs the pool.
+		/// </summary>
+		/// <param name="capacity">The maximum number of idle heaps kept by the pool.</param>
+		/// <param name="retain">The maximum number of bytes an idle heap may keep. Heaps that grew beyond this are released when they are returned.</param>
+		/// <param name="storage">The storage mode of the pool's heaps.</param>
+		json_heap_pool(uint32_t capacity, size_t retain, json_storage storage = json_storage_contiguous) noexcept;
+		json_heap_pool(const json_heap_pool& source) = delete;
+		json_heap_pool& operator=(const json_heap_pool& source) = delete;
+
+		/// <summary>
+		/// Takes an empty heap from the pool. Makes a new heap if the pool has no idle heaps.
+		/// </summary>
+		/// <returns>The heap. Null if something went wrong.</returns>
+		json_heap* acquire() noexcept;
+		/// <summary>
+		/// Returns a heap to the pool. The heap is cleared and must not be used by the caller afterwards.
+		/// </summary>
+		/// <param name="heap">The heap. Must have been taken from this pool.</param>
+		void release(json_heap* heap) noexcept;
+		/// <summary>
+		/// Returns the number of idle heaps in the pool.
+		/// </summary>
+		/// <returns>The number of idle heaps in the pool.</returns>
+		uint32_t get_count() const noexcept;
+
+	private:
+		json_storage m_storage;
+		size_t m_retain;
+		uint32_t m_capacity;
+		uint32_t m_count;
+		json_heap** m_heaps;
+	};
+	/// <summary>
+	/// Represents a child found by json_children. Names are looked up once while stepping.
+	/// </summary>
+	struct json_child final {
+		/// <summary>
+		/// The child.
+		/// </summary>
+		json_node node;
+		/// <summary>
+		/// The child's name. Null for array elements.
+		/// </summary>
+		json_string name;
+	};
+	/// <summary>
+	/// Steps through siblings. Removing the current child invalidates the iterator; adding nodes does not.
+	/// </summary>
+	struct json_child_iterator final {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = json_child;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const json_child*;
+		using reference = const json_child&;
+
+		json_child_iterator() noexcept;
+		json_child_iterator(const json_heap& heap, json_node child) noexcept;
+		reference operator*() const noexcept;
+		pointer operator->() const noexcept;
+		json_child_iterator& operator++() noexcept;
+		json_child_iterator operator++(int) noexcept;
+		bool operator==(const json_child_iterator& other) const noexcept;
+		bool operator!=(const json_child_iterator& other) const noexcept;
+
+	private:
+		const json_heap* m_heap;
+		json_child m_child;
+	};
+	/// <summary>
+	/// Represents the children of an object or array. Returned by json_heap::children and json_heap::members.
+	/// </summary>
+	struct json_children final {
+		json_children() noexcept;
+		json_children(const json_heap& heap, json_node first) noexcept;
+		json_child_iterator begin() const noexcept;
+		json_child_iterator end() const noexcept;
+
+	private:
+		const json_heap* m_heap;
+		json_node m_first;
+	};
+	/// <summary>
+	/// Steps through a subtree in depth first order using the child, sibling, and parent links. Removing nodes invalidates the iterator.
+	/// </summary>
+	struct json_descendant_iterator final {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = json_node;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const json_node*;
+		using reference = const json_node&;
+
+		json_descendant_iterator() noexcept;
+		json_descendant_iterator(const json_heap& heap, json_node root, json_node node) noexcept;
+		reference operator*() const noexcept;
+		pointer operator->() const noexcept;
+		json_descendant_iterator& operator++() noexcept;
+		json_descendant_iterator operator++(int) noexcept;
+		bool operator==(const json_descendant_iterator& other) const noexcept;
+		bool operator!=(const json_descendant_iterator& other) const noexcept;
+
+	private:
+		const json_heap* m_heap;
+		json_node m_root;
+		json_node m_node;
+	};
+	/// <summary>
+	/// Represents the descendants of a node. Returned by json_heap::descendants.
+	/// </summary>
+	struct json_descendants final {
+		json_descendants() noexcept;
+		json_descendants(const json_heap& heap, json_node root) noexcept;
+		json_descendant_iterator begin() const noexcept;
+		json_descendant_iterator end() const noexcept;
+
+	private:
+		const json_heap* m_heap;
+		json_node m_root;
+	};
+	/// <summary>
+	/// Represents a compiled json path. Supports json pointers like "/player/items/3" and a json path subset like "$.player.items[1:3]", "$..name", "$['a b'][*]", and "$.items[-1]".
+	/// Paths are compiled once and can be used to select nodes from any heap.
+	/// </summary>
+	struct json_path final {
+		/// <summary>
+		/// Deconstructs the path.
+		/// </summary>
+		~json_path() noexcept;
+		/// <summary>
+		/// Constructs an empty path. Empty paths select nothing.
+		/// </summary>
+		json_path() noexcept;
+		/// <summary>
+		/// Constructs the path.
+		/// </summary>
+		/// <param name="source">The path to copy.</param>
+		json_path(const json_path& source);
+		/// <summary>
+		/// Constructs the path.
+		/// </summary>
+		/// <param name="source">The path to move.</param>
+		json_path(json_path&& source) noexcept;
+
+		/// <summary>
+		/// Assigns the path.
+		/// </summary>
+		/// <param name="source">The path to copy.</param>
+		/// <returns>The new path.</returns>
+		json_path& operator=(const json_path& source);
+		/// <summary>
+		/// Assigns the path.
+		/// </summary>
+		/// <param name="source">The path to move.</param>
+		/// <returns>The new path.</returns>
+		json_path& operator=(json_path&& source) noexcept;
+
+		/// <summary>
+		/// Compiles the path. Expressions starting with '$' are json paths; anything else is a json pointer.
+		/// </summary>
+		/// <param name="expression">The path expression.</param>
+		/// <returns>True if successfull. False if the expression is malformed, in which case the path is empty.</returns>
+		bool compile(json_string expression) noexcept;
+		/// <summary>
+		/// Selects the nodes matched by the path. Stops once the buffer is full.
+		/// </summary>
+		/// <param name="heap">The heap.</param>
+		/// <param name="node">The node the path starts at.</param>
+		/// <param name="nodes">The buffer that receives the matched nodes.</param>
+		/// <param name="capacity">The buffer capacity.</param>
+		/// <returns>The number of nodes written to the buffer.</returns>
+		uint32_t select(const json_heap& heap, json_node node, json_node* nodes, uint32_t capacity) const noexcept;
+		/// <summary>
+		/// Selects the first node matched by the path.
+		/// </summary>
+		/// <param name="heap">The heap.</param>
+		/// <param name="node">The node the path starts at.</param>
+		/// <returns>The first node matched by the path. Zero if nothing matched or if something went wrong.</returns>
+		json_node select(const json_heap& heap, json_node node) const noexcept;
+
+	private:
+		struct json_utils;
+		struct json_step {
+			uint8_t kind;
+			bool descendant;
+			uint32_t key;
+			uint32_t length;
+			int32_t start;
+			int32_t end;
+			int32_t step;
+		};
+
+		bool m_valid;
+		uint32_t m_steps_count;
+		size_t m_size;
+		json_step* m_steps;
+	};
+	/// <summary>
+	/// Represents a cursor that appends nodes to the open object or array of a heap. Appends skip the checks done by json_heap::new_*, so they only touch the open container's last child.
+	/// Names are required inside objects and ignored inside arrays. The heap must outlive the writer.
+	/// </summary>
+	struct json_writer final {
+		/// <summary>
+		/// Constructs the writer. Nothing is open, so the first node written is a root.
+		/// </summary>
+		/// <param name="heap">The heap that receives the nodes.</param>
+		json_writer(json_heap& heap) noexcept;
+		/// <summary>
+		/// Constructs the writer and opens an existing object or array.
+		/// </summary>
+		/// <param name="heap">The heap that receives the nodes.</param>
+		/// <param name="container">The object or array to append to. Nothing is open if the node is not an object or array.</param>
+		json_writer(json_heap& heap, json_node container) noexcept;
+
+		/// <summary>
+		/// Preallocates memory for nodes and chars so the writer does not grow the heap while appending.
+		/// </summary>
+		/// <param name="nodes">The number of nodes to reserve.</param>
+		/// <param name="chars">The number of chars to reserve, including one terminator per name and string.</param>
+		/// <returns>True if successfull.</returns>
+		bool reserve(uint32_t nodes, uint32_t chars) noexcept;
+		/// <summary>
+		/// Returns the open object or array.
+		/// </summary>
+		/// <returns>The open object or array. Zero if nothing is open.</returns>
+		json_node get_cursor() const noexcept;
+
+		/// <summary>
+		/// Appends an object and opens it.
+		/// </summary>
+		/// <param name="name">The object's name.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node begin_object(json_string name = 0) noexcept;
+		/// <summary>
+		/// Appends an array and opens it.
+		/// </summary>
+		/// <param name="name">The array's name.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node begin_array(json_string name = 0) noexcept;
+		/// <summary>
+		/// Closes the open object or array and reopens its parent.
+		/// </summary>
+		/// <returns>The node that was closed. Zero if nothing was opened by this writer.</returns>
+		json_node end() noexcept;
+
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="name">The node's name.</param>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_boolean(json_string name, json_boolean value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="name">The node's name.</param>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_number(json_string name, json_number value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="name">The node's name.</param>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_string(json_string name, json_string value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="name">The node's name.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_null(json_string name) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_boolean(json_boolean value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_number(json_number value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <param name="value">The node's value.</param>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_string(json_string value) noexcept;
+		/// <summary>
+		/// Appends a node.
+		/// </summary>
+		/// <returns>The node that was made. Zero if something went wrong.</returns>
+		json_node write_null() noexcept;
+
+	private:
+		json_node alloc(json_string name, json_type type) noexcept;
+
+		json_heap& m_heap;
+		json_node m_cursor;
+		uint32_t m_depth;
+	};
+
+	/// <summary>
+	/// Represents a cursor that decodes json text straight into values without making nodes. Objects are decoded through the bindings made by NIXIE_JSON_BINDING; unknown members are validated and skipped.
+	/// The text must outlive the parser. Strings decoded as json_string are owned by the parser and are valid until it is destroyed.
+	/// </summary>
+	struct json_parser final {
+		/// <summary>
+		/// Deconstructs the parser and all strings it decoded.
+		/// </summary>
+		~json_parser() noexcept;
+		/// <summary>
+		/// Constructs the parser.
+		/// </summary>
+		/// <param name="source">The json text. Does not need to be null terminated.</param>
+		/// <param name="length">The length of the text.</param>
+		json_parser(const json_char* source, size_t length) noexcept;
+		/// <summary>
+		/// Constructs the parser.
+		/// </summary>
+		/// <param name="source">The null terminated json text.</param>
+		json_parser(json_string source) noexcept;
+		json_parser(const json_parser& source) = delete;
+		json_parser& operator=(const json_parser& source) = delete;
+
+		/// <summary>
+		/// Decodes the whole text into a value. Supports booleans, numbers, strings, vectors, and structs bound with NIXIE_JSON_BINDING.
+		/// Members missing from the text keep their values. Stops at the first syntax error or at the first value that does not have the expected type, including numbers that do not fit their field.
+		/// </summary>
+		/// <param name="value">The value that receives the text.</param>
+		/// <returns>True if the text is one json value of the expected type followed by nothing but whitespace.</returns>
+		template<typename T>
+		bool parse(T& value);
+		/// <summary>
+		/// Returns the position of the parser in the text.
+		/// </summary>
+		/// <returns>The first char that has not been decoded.</returns>
+		const json_char* get_cursor() const noexcept;
+		/// <summary>
+		/// Returns whether the parser stopped at malformed text. Values of unexpected types are not syntax errors and leave the cursor in place.
+		/// </summary>
+		/// <returns>True if the text is malformed at the cursor.</returns>
+		bool is_failed() const noexcept;
+
+		/// <summary>
+		/// Decodes a value at the cursor.
+		/// </summary>
+		/// <param name="value">The value that receives the boolean.</param>
+		/// <returns>True if successfull. False if the cursor is not at a boolean.</returns>
+		bool parse_boolean(json_boolean& value) noexcept;
+		/// <summary>
+		/// Decodes a value at the cursor.
+		/// </summary>
+		/// <param name="value">The value that receives the number.</param>
+		/// <returns>True if successfull. False if the cursor is not at a number.</returns>
+		bool parse_number(json_number& value) noexcept;
+		/// <summary>
+		/// Decodes a value at the cursor. The string is owned by the parser.
+		/// </summary>
+		/// <param name="value">The value that receives the string.</param>
+		/// <returns>True if successfull. False if the cursor is not at a string.</returns>
+		bool parse_string(json_string& value) noexcept;
+		/// <summary>
+		/// Decodes a value at the cursor.
+		/// </summary>
+		/// <param name="value">The value that receives the string.</param>
+		/// <returns>True if successfull. False if the cursor is not at a string.</returns>
+		bool parse_string(std::string& value);
+		/// <summary>
+		/// Decodes a value at the cursor.
+		/// </summary>
+		/// <returns>True if successfull. False if the cursor is not at a null.</returns>
+		bool parse_null() noexcept;
+		/// <summary>
+		/// Validates and skips the value at the cursor.
+		/// </summary>
+		/// <returns>True if successfull. False if the value is malformed.</returns>
+		bool skip() noexcept;
+		/// <summary>
+		/// Enters the object at the cursor. Its members are visited with next_member.
+		/// </summary>
+		/// <returns>True if successfull. False if the cursor is not at an object.</returns>
+		bool begin_object() noexcept;
+		/// <summary>
+		/// Moves the cursor to the value of the next member of the entered object. The previous member's value must have been decoded or skipped.
+		/// </summary>
+		/// <param name="name">Receives the member's name. Not null terminated.</param>
+		/// <param name="length">Receives the length of the member's name.</param>
+		/// <returns>True if a member follows. False at the end of the object, which is left, or if something went wrong.</returns>
+		bool next_member(const json_char*& name, uint32_t& length) noexcept;
+		/// <summary>
+		/// Enters the array at the cursor. Its elements are visited with next_element.
+		/// </summary>
+		/// <returns>True if successfull. False if the cursor is not at an array.</returns>
+		bool begin_array() noexcept;
+		/// <summary>
+		/// Moves the cursor to the next element of the entered array. The previous element must have been decoded or skipped.
+		/// </summary>
+		/// <returns>True if an element follows. False at the end of the array, which is left, or if something went wrong.</returns>
+		bool next_element() noexcept;
+
+	private:
+		struct json_utils;
+
+		const json_char* m_cursor;
+		const json_char* m_end;
+		uint32_t m_depth;
+		bool m_first;
+		bool m_failed;
+		size_t m_block_count;
+		size_t m_block_capacity;
+		json_char* m_block;
+	};
+
+	/// <summary>
+	/// Represents a cursor over newline delimited json (json lines). Every line holds one record; blank lines are skipped and "\r\n" line ends are accepted.
+	/// Records are loaded straight into the heap in one pass. A malformed record's nodes and chars are rolled back as soon as it fails, so it is skipped without leaving anything behind. The text must outlive the reader.
+	/// </summary>
+	struct json_line_reader final {
+		/// <summary>
+		/// Constructs the reader.
+		/// </summary>
+		/// <param name="source">The json lines. Does not need to be null terminated.</param>
+		/// <param name="length">The length of the text.</param>
+		json_line_reader(const json_char* source, size_t length) noexcept;
+		/// <summary>
+		/// Constructs the reader.
+		/// </summary>
+		/// <param name="source">The null terminated json lines.</param>
+		json_line_reader(json_string source) noexcept;
+
+		/// <summary>
+		/// Loads the next record into a heap as a new root and moves past its line.
+		/// </summary>
+		/// <param name="heap">The heap that receives the record.</param>
+		/// <returns>The record. Zero at the end of the text or if the record is malformed; use is_end to tell them apart.</returns>
+		json_node next(json_heap& heap) noexcept;
+		/// <summary>
+		/// Loads the next record into a heap as a new root and moves past its line. Describes why if the record is malformed, so bad records can be logged and skipped.
+		/// </summary>
+		/// <param name="heap">The heap that receives the record.</param>
+		/// <param name="error">Receives the reason the record is malformed. Offsets are counted from the start of the reader's text and lines from its first line.</param>
+		/// <returns>The record. Zero at the end of the text or if the record is malformed; use is_end to tell them apart.</returns>
+		json_node next(json_heap& heap, json_error& error) noexcept;
+		/// <summary>
+		/// Loads records into a heap until the buffer is full or the text ends. Malformed records are skipped.
+		/// Clearing the heap between batches keeps its memory bounded by the largest batch.
+		/// </summary>
+		/// <param name="heap">The heap that receives the records.</param>
+		/// <param name="nodes">The buffer that receives the records.</param>
+		/// <param name="capacity">The buffer capacity.</param>
+		/// <returns>The number of records written to the buffer.</returns>
+		uint32_t next(json_heap& heap, json_node* nodes, uint32_t capacity) noexcept;
+		/// <summary>
+		/// Decodes the next record straight into a value with json_parser and moves past its line.
+		/// </summary>
+		/// <param name="value">The value that receives the record.</param>
+		/// <returns>True if successfull. False at the end of the text or if the record is malformed or has an unexpected type.</returns>
+		template<typename T>
+		bool next(T& value);
+		/// <summary>
+		/// Returns whether all records have been read.
+		/// </summary>
+		/// <returns>True if only blank lines remain.</returns>
+		bool is_end() noexcept;
+		/// <summary>
+		/// Returns the line number of the record that was read last, starting at one.
+		/// </summary>
+		/// <returns>The line number. Zero if nothing was read.</returns>
+		uint64_t get_line() const noexcept;
+		/// <summary>
+		/// Returns the position of the reader in the text.
+		/// </summary>
+		/// <returns>The start of the line after the record that was read last.</returns>
+		const json_char* get_cursor() const noexcept;
+
+		/// <summary>
+		/// Loads all records with one thread per heap. The text is split at line ends into one range per heap, so each heap receives a run of consecutive records in order.
+		/// Malformed records are skipped. Heaps may already hold nodes; they must not be used by other threads while loading.
+		/// </summary>
+		/// <param name="source">The json lines. Does not need to be null terminated.</param>
+		/// <param name="length">The length of the text.</param>
+		/// <param name="heaps">The heaps that receive the records.</param>
+		/// <param name="roots">The vectors that receive the records of each heap. One per heap; records are appended.</param>
+		/// <param name="count">The number of heaps and threads.</param>
+		/// <returns>The number of records that were loaded.</returns>
+		static uint64_t load_parallel(const json_char* source, size_t length, json_heap* heaps, std::vector<json_node>* roots, uint32_t count);
+
+	private:
+		struct json_utils;
+
+		const json_char* m_source;
+		const json_char* m_cursor;
+		const json_char* m_end;
+		uint64_t m_line;
+	};
+
+	/// <summary>
+	/// Loads a list of files one after another. A background thread reads and decompresses the next files while the caller parses the current one.
+	/// Parsing happens on the calling thread, so heaps are never touched by the background thread.
+	/// </summary>
+	struct json_file_reader final {
+		/// <summary>
+		/// Stops reading and deconstructs the reader and its buffers.
+		/// </summary>
+		~json_file_reader() noexcept;
+		/// <summary>
+		/// Constructs the reader and starts reading the first files.
+		/// </summary>
+		/// <param name="paths">The paths of the files. They are copied, so they do not need to outlive the reader.</param>
+		/// <param name="count">The number of files.</param>
+		/// <param name="ahead">The most files read ahead of the caller. Each keeps a buffer as large as the largest file it held.</param>
+		json_file_reader(const json_string* paths, uint32_t count, uint32_t ahead = 2u) noexcept;
+		/// <summary>
+		/// Constructs the reader and starts reading the first files.
+		/// </summary>
+		/// <param name="paths">The paths of the files. They are copied, so they do not need to outlive the reader.</param>
+		/// <param name="ahead">The most files read ahead of the caller. Each keeps a buffer as large as the largest file it held.</param>
+		json_file_reader(const std::vector<std::string>& paths, uint32_t ahead = 2u) noexcept;
+		json_file_reader(const json_file_reader& source) = delete;
+		json_file_reader& operator=(const json_file_reader& source) = delete;
+
+		/// <summary>
+		/// Loads the next file into a heap as a new root. Waits if the file has not been read yet.
+		/// </summary>
+		/// <param name="heap">The heap that receives the file.</param>
+		/// <param name="format">The json format.</param>
+		/// <returns>The json destination. Zero after the last file or if the file could not be read or loaded; use is_end to tell them apart.</returns>
+		json_node next(json_heap& heap, json_format format = json_format_pretty) noexcept;
+		/// <summary>
+		/// Loads the next file into a heap as a new root and describes why if it could not be loaded. Waits if the file has not been read yet.
+		/// </summary>
+		/// <param name="heap">The heap that receives the file.</param>
+		/// <param name="format">The json format.</param>
+		/// <param name="error">Receives the reason the file could not be loaded. Only its code is reset if loading succeeds or no files remain.</param>
+		/// <returns>The json destination. Zero after the last file or if the file could not be read or loaded; use is_end to tell them apart.</returns>
+		json_node next(json_heap& heap, json_format format, json_error& error) noexcept;
+		/// <summary>
+		/// Returns whether all files have been loaded.
+		/// </summary>
+		/// <returns>True if no files remain.</returns>
+		bool is_end() const noexcept;
+		/// <summary>
+		/// Returns the path of the file that was loaded last.
+		/// </summary>
+		/// <returns>The path. Zero if nothing was loaded.</returns>
+		json_string get_path() const noexcept;
+
+	private:
+		struct json_utils;
+		struct json_state;
+
+		json_state* m_state;
+	};
+	/// <summary>
+	/// Writes files on a background thread. The caller saves the next document while earlier ones are compressed and written to disk.
+	/// Writes are done in the order they were queued.
+	/// </summary>
+	struct json_file_writer final {
+		/// <summary>
+		/// Waits for all queued writes and deconstructs the writer and its buffers.
+		/// </summary>
+		~json_file_writer() noexcept;
+		/// <summary>
+		/// Constructs the writer.
+		/// </summary>
+		/// <param name="capacity">The most writes that can be queued. Queueing more waits until a write finishes.</param>
+		/// <param name="compression">The compression of the written files.</param>
+		json_file_writer(uint32_t capacity = 4u, json_compression compression = json_compression_none) noexcept;
+		json_file_writer(const json_file_writer& source) = delete;
+		json_file_writer& operator=(const json_file_writer& source) = delete;
+
+		/// <summary>
+		/// Queues a copy of the text to be written to a file.
+		/// </summary>
+		/// <param name="destination">The path of the file. The file is replaced if it exists.</param>
+		/// <param name="source">The text. Does not need to be null terminated.</param>
+		/// <param name="length">The length of the text.</param>
+		/// <returns>Becomes true once the file was written. False if something went wrong.</returns>
+		std::future<bool> write(json_string destination, const json_char* source, size_t length);
+		/// <summary>
+		/// Saves the json and queues it to be written to a file. The heap's output buffer is handed to the writer instead of being copied,
+		/// so strings returned by the heap's earlier save calls become invalid.
+		/// </summary>
+		/// <param name="destination">The path of the file. The file is replaced if it exists.</param>
+		/// <param name="heap">The heap that holds the json.</param>
+		/// <param name="source">The json source.</param>
+		/// <param name="format">The json format.</param>
+		/// <returns>Becomes true once the file was written. False if something went wrong.</returns>
+		std::future<bool> write(json_string destination, json_heap& heap, json_node source, json_format format = json_format_pretty);
+		/// <summary>
+		/// Waits until every queued write has finished.
+		/// </summary>
+		/// <returns>True if every write since the last flush was successfull. False if something went wrong.</returns>
+		bool flush() noexcept;
+
+	private:
+		struct json_utils;
+		struct json_state;
+
+		json_state* m_state;
+	};
+
+	/// <summary>
+	/// Describes one member of a bound struct. Made by NIXIE_JSON_FIELD.
+	/// </summary>
+	template<typename T>
+	struct json_field final {
+		json_string name;
+		bool (*read)(const json_heap& heap, json_node node, T& value);
+		json_node (*write)(json_heap& heap, json_node parent, json_string name, const T& value);
+		bool (*parse)(json_parser& parser, T& value);
+	};
+	/// <summary>
+	/// Lists the members of a struct. Specialized by NIXIE_JSON_BINDING.
+	/// </summary>
+	template<typename T>
+	struct json_binding;
+	/// <summary>
+	/// Converts values to and from nodes. The parent of a written node is an object when a name is given, an array when it is not, and nothing when the parent is zero.
+	/// Specialize to support more types, including parse for json_parser; the unspecialized template handles structs bound with NIXIE_JSON_BINDING.
+	/// </summary>
+	template<typename T, typename = void>
+	struct json_convert {
+		static bool read(const json_heap& heap, json_node node, T& value);
+		static json_node write(json_heap& heap, json_node parent, json_string name, const T& value);
+		static bool parse(json_parser& parser, T& value);
+	};
+	template<>
+	struct json_convert<bool> {
+		static bool read(const json_heap& heap, json_node node, bool& value) {
+			if (!heap.is_boolean(node))
+				return false;
+			value = heap.to_boolean(node, false);
+			return true;
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const bool& value) {
+			return !parent ? heap.new_boolean(value) : name ? heap.new_boolean(parent, name, value) : heap.new_boolean(parent, value);
+		}
+		static bool parse(json_parser& parser, bool& value) {
+			return parser.parse_boolean(value);
+		}
+	};
+	template<typename T>
+	struct json_convert<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+		static bool read(const json_heap& heap, json_node node, T& value) {
+			return heap.is_number(node) && convert(heap.to_number(node, 0.0), value);
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const T& value) {
+			json_number number = json_number(value);
+			return !parent ? heap.new_number(number) : name ? heap.new_number(parent, name, number) : heap.new_number(parent, number);
+		}
+		static bool parse(json_parser& parser, T& value) {
+			json_number number;
+			return parser.parse_number(number) && convert(number, value);
+		}
+		static bool convert(json_number number, T& value) noexcept {
+			//casting a number that does not fit is undefined, so it is rejected. integers must also be whole.
+			//the integer bounds are powers of two, which doubles hold exactly.
+			if (std::is_integral<T>::value) {
+				json_number low = json_number(std::numeric_limits<T>::min());
+				json_number high = json_number(std::numeric_limits<T>::max() / 2 + 1) * 2.0;
+				if (!(number >= low && number < high) || json_number(T(number)) != number)
+					return false;
+			}
+			else if (!(number >= -json_number(std::numeric_limits<T>::max()) && number <= json_number(std::numeric_limits<T>::max()))) {
+				return false;
+			}
+			value = T(number);
+			return true;
+		}
+	};
+	template<>
+	struct json_convert<json_string> {
+		static bool read(const json_heap& heap, json_node node, json_string& value) {
+			//the string is owned by the heap.
+			if (!heap.is_string(node))
+				return false;
+			value = heap.to_string(node, "");
+			return true;
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const json_string& value) {
+			return !parent ? heap.new_string(value) : name ? heap.new_string(parent, name, value) : heap.new_string(parent, value);
+		}
+		static bool parse(json_parser& parser, json_string& value) {
+			//the string is owned by the parser.
+			return parser.parse_string(value);
+		}
+	};
+	template<>
+	struct json_convert<std::string> {
+		static bool read(const json_heap& heap, json_node node, std::string& value) {
+			if (!heap.is_string(node))
+				return false;
+			value = heap.to_string(node, "");
+			return true;
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const std::string& value) {
+			return json_convert<json_string>::write(heap, parent, name, value.c_str());
+		}
+		static bool parse(json_parser& parser, std::string& value) {
+			return parser.parse_string(value);
+		}
+	};
+	template<typename T>
+	struct json_convert<std::vector<T>> {
+		static bool read(const json_heap& heap, json_node node, std::vector<T>& value) {
+			if (!heap.is_array(node))
+				return false;
+			value.clear();
+			bool result = true;
+			for (const json_child& child : heap.children(node)) {
+				value.emplace_back();
+				result = json_convert<T>::read(heap, child.node, value.back()) && result;
+			}
+			return result;
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const std::vector<T>& value) {
+			json_node array = !parent ? heap.new_array() : name ? heap.new_array(parent, name) : heap.new_array(parent);
+			for (size_t i = 0; array && i < value.size(); ++i)
+				if (!json_convert<T>::write(heap, array, 0, value[i]))
+					return 0;
+			return array;
+		}
+		static bool parse(json_parser& parser, std::vector<T>& value) {
+			if (!parser.begin_array())
+				return false;
+			value.clear();
+			while (parser.next_element()) {
+				value.emplace_back();
+				if (!json_convert<T>::parse(parser, value.back()))
+					return false;
+			}
+			return !parser.is_failed();
+		}
+	};
+	/// <summary>
+	/// Finds the members of a bound struct by name. Built once per struct on first use; the hash seed is searched until every name has its own slot, so a lookup is one hash and one compare.
+	/// </summary>
+	template<typename T>
+	struct json_binding_index final {
+		static const json_binding_index& get() {
+			static const json_binding_index index;
+			return index;
+		}
+		const json_field<T>* find(const json_char* name, uint32_t length) const noexcept {
+			uint32_t field = m_slots[hash(name, length, m_seed) & m_mask];
+			if (!field || m_lengths[field - 1u] != length || memcmp(m_fields[field - 1u].name, name, length) != 0)
+				return 0;
+			return &m_fields[field - 1u];
+		}
+		const json_field<T>* find(json_string name) const noexcept {
+			return find(name, uint32_t(strlen(name)));
+		}
+		const json_field<T>* get_fields() const noexcept {
+			return m_fields;
+		}
+		uint32_t get_count() const noexcept {
+			return m_count;
+		}
+
+	private:
+		json_binding_index() : m_count(0), m_fields(json_binding<T>::get_fields(m_count)), m_seed(0) {
+			m_lengths.resize(m_count);
+			for (uint32_t i = 0; i < m_count; ++i)
+				m_lengths[i] = uint32_t(strlen(m_fields[i].name));
+			uint32_t size = 8;
+			while (size < m_count)
+				size <<= 1;
+			while (!place(size))
+				size <<= 1;
+		}
+		bool place(uint32_t size) {
+			//tries a few seeds per table size; duplicate names keep the first field.
+			m_mask = size - 1u;
+			for (m_seed = 0; m_seed < 64u; ++m_seed) {
+				m_slots.assign(size, 0);
+				uint32_t i = 0;
+				for (; i < m_count; ++i) {
+					uint32_t& slot = m_slots[hash(m_fields[i].name, m_lengths[i], m_seed) & m_mask];
+					if (slot && (m_lengths[slot - 1u] != m_lengths[i] || memcmp(m_fields[slot - 1u].name, m_fields[i].name, m_lengths[i]) != 0))
+						break;
+					if (!slot)
+						slot = i + 1u;
+				}
+				if (i == m_count)
+					return true;
+			}
+			return false;
+		}
+		static uint32_t hash(const json_char* name, uint32_t length, uint32_t seed) noexcept {
+			uint32_t x = 2166136261u ^ (seed * 0x9E3779B9u);
+			for (uint32_t i = 0; i < length; ++i)
+				x = (x ^ uint8_t(name[i])) * 16777619u;
+			return x ^ (x >> 16);
+		}
+
+		uint32_t m_count;
+		const json_field<T>* m_fields;
+		uint32_t m_seed;
+		uint32_t m_mask;
+		std::vector<uint32_t> m_lengths;
+		std::vector<uint32_t> m_slots;
+	};
+	/// <summary>
+	/// Reads, writes, and parses one member of a bound struct. Referenced by NIXIE_JSON_FIELD.
+	/// </summary>
+	template<typename T, typename M, M T::* P>
+	struct json_member final {
+		static bool read(const json_heap& heap, json_node node, T& value) {
+			return json_convert<M>::read(heap, node, value.*P);
+		}
+		static json_node write(json_heap& heap, json_node parent, json_string name, const T& value) {
+			return json_convert<M>::write(heap, parent, name, value.*P);
+		}
+		static bool parse(json_parser& parser, T& value) {
+			return json_convert<M>::parse(parser, value.*P);
+		}
+	};
+	template<typename T, typename U>
+	bool json_convert<T, U>::read(const json_heap& heap, json_node node, T& value) {
+		//one pass over the children; each name is found in the struct's index instead of scanning the object per member.
+		if (!heap.is_object(node))
+			return false;
+		const json_binding_index<T>& index = json_binding_index<T>::get();
+		bool result = true;
+		for (const json_child& child : heap.members(node)) {
+			const json_field<T>* field = index.find(child.name);
+			if (field && !field->read(heap, child.node, value))
+				result = false;
+		}
+		return result;
+	}
+	template<typename T, typename U>
+	json_node json_convert<T, U>::write(json_heap& heap, json_node parent, json_string name, const T& value) {
+		const json_binding_index<T>& index = json_binding_index<T>::get();
+		json_node object = !parent ? heap.new_object() : name ? heap.new_object(parent, name) : heap.new_object(parent);
+		for (uint32_t i = 0; object && i < index.get_count(); ++i)
+			if (!index.get_fields()[i].write(heap, object, index.get_fields()[i].name, value))
+				return 0;
+		return object;
+	}
+	template<typename T, typename U>
+	bool json_convert<T, U>::parse(json_parser& parser, T& value) {
+		//members are dispatched by the struct's perfect hash as their names are scanned; unknown members are skipped without decoding.
+		if (!parser.begin_object())
+			return false;
+		const json_binding_index<T>& index = json_binding_index<T>::get();
+		const json_char* name;
+		uint32_t length;
+		while (parser.next_member(name, length)) {
+			const json_field<T>* field = index.find(name, length);
+			if (field ? !field->parse(parser, value) : !parser.skip())
+				return false;
+		}
+		return !parser.is_failed();
+	}
+
+	inline const json_heap::json_value& json_heap::get_value(json_node node) const noexcept {
+		return m_values[uint64_t(node) >> m_values_shift].data[node & uint32_t((uint64_t(1) << m_values_shift) - 1u)];
+	}
+	inline json_string json_heap::get_chars(json_node id) const noexcept {
+		return m_chars[uint64_t(id) >> m_chars_shift].data + (id & uint32_t((uint64_t(1) << m_chars_shift) - 1u));
+	}
+	inline json_child_iterator::json_child_iterator() noexcept : m_heap(0), m_child{ 0, 0 } {
+
+	}
+	inline json_child_iterator::json_child_iterator(const json_heap& heap, json_node child) noexcept : m_heap(&heap), m_child{ child, 0 } {
+		if (child) {
+			const json_heap::json_value& v = heap.get_value(child);
+			m_child.name = v.name ? heap.get_chars(v.name) : 0;
+			NIXIE_JSON_PREFETCH(&heap.get_value(v.next));
+		}
+	}
+	inline json_child_iterator::reference json_child_iterator::operator*() const noexcept {
+		return m_child;
+	}
+	inline json_child_iterator::pointer json_child_iterator::operator->() const noexcept {
+		return &m_child;
+	}
+	inline json_child_iterator& json_child_iterator::operator++() noexcept {
+		//the next sibling was prefetched by the previous step, and this step prefetches the one after it.
+		json_node next = m_heap->get_value(m_child.node).next;
+		m_child.node = next;
+		m_child.name = 0;
+		if (next) {
+			const json_heap::json_value& v = m_heap->get_value(next);
+			if (v.name)
+				m_child.name = m_heap->get_chars(v.name);
+			NIXIE_JSON_PREFETCH(&m_heap->get_value(v.next));
+		}
+		return *this;
+	}
+	inline json_child_iterator json_child_iterator::operator++(int) noexcept {
+		json_child_iterator copy = *this;
+		++*this;
+		return copy;
+	}
+	inline bool json_child_iterator::operator==(const json_child_iterator& other) const noexcept {
+		return m_child.node == other.m_child.node;
+	}
+	inline bool json_child_iterator::operator!=(const json_child_iterator& other) const noexcept {
+		return m_child.node != other.m_child.node;
+	}
+	inline json_children::json_children() noexcept : m_heap(0), m_first(0) {
+
+	}
+	inline json_children::json_children(const json_heap& heap, json_node first) noexcept : m_heap(&heap), m_first(first) {
+
+	}
+	inline json_child_iterator json_children::begin() const noexcept {
+		return m_first ? json_child_iterator(*m_heap, m_first) : json_child_iterator();
+	}
+	inline json_child_iterator json_children::end() const noexcept {
+		return json_child_iterator();
+	}
+	inline json_descendant_iterator::json_descendant_iterator() noexcept : m_heap(0), m_root(0), m_node(0) {
+
+	}
+	inline json_descendant_iterator::json_descendant_iterator(const json_heap& heap, json_node root, json_node node) noexcept : m_heap(&heap), m_root(root), m_node(node) {
+
+	}
+	inline json_descendant_iterator::reference json_descendant_iterator::operator*() const noexcept {
+		return m_node;
+	}
+	inline json_descendant_iterator::pointer json_descendant_iterator::operator->() const noexcept {
+		return &m_node;
+	}
+	inline json_descendant_iterator& json_descendant_iterator::operator++() noexcept {
+		//descends into the first child, otherwise climbs until a node has a next sibling. the subtree was resolved up front; malformed lazy nodes are stepped over.
+		const json_heap::json_value& v = m_heap->get_value(m_node);
+		if (!v.lazy && (v.type == json_type_object || v.type == json_type_array) && v.object_or_array.first) {
+			m_node = v.object_or_array.first;
+			NIXIE_JSON_PREFETCH(&m_heap->get_value(m_heap->get_value(m_node).next));
+			return *this;
+		}
+		json_node curr = m_node;
+		while (curr != m_root) {
+			const json_heap::json_value& c = m_heap->get_value(curr);
+			if (c.next) {
+				m_node = c.next;
+				return *this;
+			}
+			curr = c.parent;
+		}
+		m_node = 0;
+		return *this;
+	}
+	inline json_descendant_iterator json_descendant_iterator::operator++(int) noexcept {
+		json_descendant_iterator copy = *this;
+		++*this;
+		return copy;
+	}
+	inline bool json_descendant_iterator::operator==(const json_descendant_iterator& other) const noexcept {
+		return m_node == other.m_node;
+	}
+	inline bool json_descendant_iterator::operator!=(const json_descendant_iterator& other) const noexcept {
+		return m_node != other.m_node;
+	}
+	inline json_descendants::json_descendants() noexcept : m_heap(0), m_root(0) {
+
+	}
+	inline json_descendants::json_descendants(const json_heap& heap, json_node root) noexcept : m_heap(&heap), m_root(root) {
+
+	}
+	inline json_descendant_iterator json_descendants::begin() const noexcept {
+		if (!m_root)
+			return json_descendant_iterator();
+		const json_heap::json_value& v = m_heap->get_value(m_root);
+		bool container = !v.lazy && (v.type == json_type_object || v.type == json_type_array);
+		return json_descendant_iterator(*m_heap, m_root, container ? v.object_or_array.first : 0);
+	}
+	inline json_descendant_iterator json_descendants::end() const noexcept {
+		return json_descendant_iterator();
+	}
+
+	template<typename F>
+	void json_heap::for_each_node(json_type type, F function, uint32_t threads) const {
+		struct task {
+			const json_heap* heap;
+			json_type type;
+			F* function;
+			uint32_t count;
+			static void run(void* context, uint32_t index) {
+				const task& t = *(const task*)context;
+				json_node first, last;
+				t.heap->get_parallel_range(index, t.count, first, last);
+				for (json_node node = first; node && node <= last; ++node) {
+					json_type type = t.heap->get_value(node).type;
+					if (type != json_type_invalid && (t.type == json_type_invalid || type == t.type))
+						(*t.function)(node);
+				}
+			}
+		};
+		task t = { this, type, &function, get_parallel_ranges(threads) };
+		run_parallel(t.count, &task::run, &t);
+	}
+	template<typename T, typename M, typename C>
+	T json_heap::reduce(json_type type, T identity, M map, C combine, uint32_t threads) const {
+		struct task {
+			const json_heap* heap;
+			json_type type;
+			M* map;
+			C* combine;
+			uint32_t count;
+			T* results;
+			static void run(void* context, uint32_t index) {
+				const task& t = *(const task*)context;
+				json_node first, last;
+				t.heap->get_parallel_range(index, t.count, first, last);
+				T result = std::move(t.results[index]);
+				for (json_node node = first; node && node <= last; ++node) {
+					json_type type = t.heap->get_value(node).type;
+					if (type != json_type_invalid && (t.type == json_type_invalid || type == t.type))
+						result = (*t.combine)(std::move(result), (*t.map)(node));
+				}
+				t.results[index] = std::move(result);
+			}
+		};
+		std::vector<T> results(get_parallel_ranges(threads), identity);
+		task t = { this, type, &map, &combine, uint32_t(results.size()), results.data() };
+		run_parallel(t.count, &task::run, &t);
+		T result = std::move(results[0]);
+		for (size_t i = 1; i < results.size(); ++i)
+			result = combine(std::move(result), std::move(results[i]));
+		return result;
+	}
+	template<typename T>
+	bool json_heap::read(json_node node, T& value) const {
+		return json_convert<T>::read(*this, node, value);
+	}
+	template<typename T>
+	json_node json_heap::write(json_node object, json_string name, const T& value) {
+		return json_convert<typename std::decay<const T>::type>::write(*this, object, name, value);
+	}
+	template<typename T>
+	json_node json_heap::write(json_node array, const T& value) {
+		return json_convert<typename std::decay<const T>::type>::write(*this, array, 0, value);
+	}
+	template<typename T>
+	json_node json_heap::write(const T& value) {
+		return json_convert<typename std::decay<const T>::type>::write(*this, 0, 0, value);
+	}
+	template<typename T>
+	bool json_parser::parse(T& value) {
+		if (!json_convert<T>::parse(*this, value))
+			return false;
+		while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r'))
+			++m_cursor;
+		return m_cursor == m_end;
+	}
+	template<typename T>
+	bool json_line_reader::next(T& value) {
+		if (is_end())
+			return false;
+		const json_char* line = m_cursor;
+		const json_char* end = (const json_char*)memchr(line, '\n', size_t(m_end - line));
+		m_cursor = end ? end + 1 : m_end;
+		++m_line;
+		json_parser parser(line, size_t((end ? end : m_end) - line));
+		return parser.parse(value);
+	}
 }
+/// <summary>
+/// Makes the descriptor of one member for NIXIE_JSON_BINDING. The member's name is used as the json name.
+/// </summary>
+#define NIXIE_JSON_FIELD(type, member) ::nix::json_field<type>{ #member, &::nix::json_member<type, decltype(type::member), &type::member>::read, &::nix::json_member<type, decltype(type::member), &type::member>::write, &::nix::json_member<type, decltype(type::member), &type::member>::parse }
+/// <summary>
+/// Binds a struct's members so json_heap::read, json_heap::write, and json_parser::parse can convert it. Use at global scope after the struct, e.g. NIXIE_JSON_BINDING(player, NIXIE_JSON_FIELD(player, name), NIXIE_JSON_FIELD(player, items)).
+/// </summary>
+#define NIXIE_JSON_BINDING(type, ...) namespace nix { template<> struct json_binding<type> { static const json_field<type>* get_fields(uint32_t& count) noexcept { static const json_field<type> fields[] = { __VA_ARGS__ }; count = uint32_t(sizeof(fields) / sizeof(fields[0])); return fields; } }; }
 #endif
 /*
 MIT License